@@ -0,0 +1,369 @@
+/*
+ * Runs the audio pipeline on the host and reports its throughput, queue depths and stage latencies.
+ *
+ * The microphone is a WAV file (or silence). Every uplink frame is looped back as a downlink frame
+ * after a simulated network delay, decoded and played into a WAV file (or discarded). A system sound
+ * is played over it at a fixed interval, so the Ogg demuxer, the effects bus and the mixer run too.
+ *
+ * Opus is a PCM passthrough on the host (see shims/esp_opus_enc.h), so the encode and decode stages
+ * measure the pipeline around the codec, not the codec itself.
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+
+#include <board.h>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+
+#define TAG "AudioPipelineBench"
+
+#ifndef ASSETS_DIR
+#define ASSETS_DIR "main/assets"
+#endif
+
+struct Options {
+    std::string input_path;
+    std::string output_path;
+    std::string sound_path = ASSETS_DIR "/common/popup.ogg";
+    float speed = 1.0f;
+    int frames = 500;
+    int frame_duration_ms = 60;
+    int output_sample_rate = 24000;
+    int network_delay_ms = 40;
+    int jitter_ms = 0;
+    int sound_interval_ms = 3000;
+    bool verbose = false;
+};
+
+struct DepthStats {
+    uint64_t sum = 0;
+    uint32_t max = 0;
+
+    void Add(uint32_t depth) {
+        sum += depth;
+        max = std::max(max, depth);
+    }
+};
+
+struct DelayedPacket {
+    int64_t due_us;
+    std::unique_ptr<AudioStreamPacket> packet;
+};
+
+static void PrintUsage(const char* name) {
+    printf("Usage: %s [options]\n"
+           "  --input PATH            WAV file played into the microphone, silence if not given\n"
+           "  --output PATH           WAV file receiving the speaker output, discarded if not given\n"
+           "  --sound PATH            OGG sound played over the downlink, \"\" for none\n"
+           "  --speed X               Playback speed, 0 runs as fast as the host can (default 1)\n"
+           "  --frames N              Uplink frames to loop back (default 500)\n"
+           "  --frame-duration MS     Uplink and downlink frame duration, 20, 40 or 60 (default 60)\n"
+           "  --output-rate HZ        Codec output sample rate (default 24000)\n"
+           "  --network-delay MS      One-way delay of the simulated network (default 40)\n"
+           "  --jitter MS             Extra random delay per frame, frames may arrive reordered (default 0)\n"
+           "  --sound-interval MS     Audio time between two sounds (default 3000)\n"
+           "  --verbose               Keep the pipeline's info logs\n", name);
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--input") {
+            options.input_path = value;
+        } else if (arg == "--output") {
+            options.output_path = value;
+        } else if (arg == "--sound") {
+            options.sound_path = value;
+        } else if (arg == "--speed") {
+            options.speed = atof(value);
+        } else if (arg == "--frames") {
+            options.frames = atoi(value);
+        } else if (arg == "--frame-duration") {
+            options.frame_duration_ms = atoi(value);
+        } else if (arg == "--output-rate") {
+            options.output_sample_rate = atoi(value);
+        } else if (arg == "--network-delay") {
+            options.network_delay_ms = atoi(value);
+        } else if (arg == "--jitter") {
+            options.jitter_ms = atoi(value);
+        } else if (arg == "--sound-interval") {
+            options.sound_interval_ms = atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return options.frames > 0 && options.speed >= 0 &&
+        (options.frame_duration_ms == 20 || options.frame_duration_ms == 40 || options.frame_duration_ms == 60);
+}
+
+static void PrintLatencies(LatencyTracer& tracer) {
+    cJSON* histograms = tracer.GetHistogramJson();
+    printf("\n%-16s %8s %8s %8s %8s %8s\n", "latency (ms)", "count", "avg", "p50", "p95", "max");
+    for (cJSON* stage = histograms->child; stage != nullptr; stage = stage->next) {
+        if (!cJSON_IsObject(stage)) {
+            continue;
+        }
+        printf("%-16s %8d %8d %8d %8d %8d\n", stage->string,
+            cJSON_GetObjectItem(stage, "count")->valueint, cJSON_GetObjectItem(stage, "avg_ms")->valueint,
+            cJSON_GetObjectItem(stage, "p50_ms")->valueint, cJSON_GetObjectItem(stage, "p95_ms")->valueint,
+            cJSON_GetObjectItem(stage, "max_ms")->valueint);
+    }
+    cJSON_Delete(histograms);
+}
+
+static uint32_t DownlinkCount(LatencyTracer& tracer) {
+    cJSON* histograms = tracer.GetHistogramJson();
+    cJSON* downlink = cJSON_GetObjectItem(histograms, "downlink");
+    uint32_t count = downlink != nullptr ? cJSON_GetObjectItem(downlink, "count")->valueint : 0;
+    cJSON_Delete(histograms);
+    return count;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", options.verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    std::string sound;
+    if (!options.sound_path.empty()) {
+        std::ifstream file(options.sound_path, std::ios::binary);
+        if (!file) {
+            ESP_LOGE(TAG, "Failed to open sound %s", options.sound_path.c_str());
+            return 1;
+        }
+        sound.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    WavAudioCodec codec(options.input_path, options.output_path, options.output_sample_rate, options.speed);
+    Board::GetInstance().SetAudioCodec(&codec);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    AudioService audio_service;
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [&]() {
+        cv.notify_one();
+    };
+    audio_service.Initialize(&codec);
+    audio_service.SetCallbacks(callbacks);
+    audio_service.Start();
+    audio_service.SetEncodeFrameDuration(options.frame_duration_ms);
+    audio_service.PowerUpOutput();
+    audio_service.EnableVoiceProcessing(true);
+
+    /* The server side: decode the uplink frame, bring it to the output rate and encode it again */
+    esp_opus_dec_cfg_t server_dec_cfg = {
+        .sample_rate = 16000,
+        .channel = ESP_AUDIO_MONO,
+        .frame_duration = (esp_opus_dec_frame_duration_t)AS_OPUS_GET_FRAME_DRU_ENUM(options.frame_duration_ms),
+        .self_delimited = false,
+    };
+    void* server_decoder = nullptr;
+    esp_opus_dec_open(&server_dec_cfg, sizeof(server_dec_cfg), &server_decoder);
+    esp_opus_enc_config_t server_enc_cfg = AS_OPUS_ENC_CONFIG(options.frame_duration_ms);
+    server_enc_cfg.sample_rate = options.output_sample_rate;
+    void* server_encoder = nullptr;
+    esp_opus_enc_open(&server_enc_cfg, sizeof(server_enc_cfg), &server_encoder);
+    int server_frame_bytes = 0;
+    int server_packet_bytes = 0;
+    esp_opus_enc_get_frame_size(server_encoder, &server_frame_bytes, &server_packet_bytes);
+    esp_ae_rate_cvt_cfg_t server_cvt_cfg = {
+        .src_rate = 16000,
+        .dest_rate = (uint32_t)options.output_sample_rate,
+        .channel = ESP_AUDIO_MONO,
+        .bits_per_sample = ESP_AUDIO_BIT16,
+        .complexity = 2,
+        .perf_type = ESP_AE_RATE_CVT_PERF_TYPE_SPEED,
+    };
+    esp_ae_rate_cvt_handle_t server_resampler = nullptr;
+    esp_ae_rate_cvt_open(&server_cvt_cfg, &server_resampler);
+    std::vector<int16_t> uplink_pcm(16000 / 1000 * options.frame_duration_ms);
+    std::vector<int16_t> downlink_pcm;
+
+    /* Wall time runs faster than audio time when the codec is sped up, the network follows the codec */
+    auto scale_us = [&](int ms) -> int64_t {
+        return options.speed > 0 ? (int64_t)(ms * 1000 / options.speed) : 0;
+    };
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> jitter(0, options.jitter_ms);
+    std::deque<DelayedPacket> in_flight;
+
+    DepthStats encode_depth, send_depth, decode_depth, playback_depth, effects_depth;
+    uint64_t depth_samples = 0;
+    int sent = 0;
+    int queued = 0;
+    int delivered = 0;
+    int64_t next_sound_ms = 0;
+    int64_t next_sample_us = 0;
+    int64_t start_us = esp_timer_get_time();
+    int64_t timeout_us = (options.speed > 0 ? scale_us(options.frames * options.frame_duration_ms) * 2 : 0) + 60000000;
+
+    while (sent < options.frames || !in_flight.empty()) {
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - start_us > timeout_us) {
+            ESP_LOGE(TAG, "Timed out after %d of %d frames", sent, options.frames);
+            break;
+        }
+
+        /* Sample the queues every 10 ms of audio time */
+        if (now_us >= next_sample_us) {
+            auto statistics = audio_service.GetDebugStatistics();
+            encode_depth.Add(statistics.encode_queue_depth);
+            send_depth.Add(statistics.send_queue_depth);
+            decode_depth.Add(statistics.decode_queue_depth);
+            playback_depth.Add(statistics.playback_queue_depth);
+            effects_depth.Add(statistics.effects_queue_depth);
+            depth_samples++;
+            next_sample_us = now_us + std::max<int64_t>(scale_us(10), 1000);
+        }
+
+        /* Uplink: send the encoded frames into the simulated network */
+        while (sent < options.frames) {
+            auto packet = audio_service.PopPacketFromSendQueue();
+            if (packet == nullptr) {
+                break;
+            }
+            audio_service.RecordPacketSent(*packet);
+            esp_audio_dec_in_raw_t raw = {
+                .buffer = packet->payload.data(),
+                .len = (uint32_t)packet->payload.size(),
+                .consumed = 0,
+                .frame_recover = ESP_AUDIO_DEC_RECOVERY_NONE,
+            };
+            esp_audio_dec_out_frame_t decoded = {
+                .buffer = (uint8_t*)uplink_pcm.data(),
+                .len = (uint32_t)(uplink_pcm.size() * sizeof(int16_t)),
+                .decoded_size = 0,
+            };
+            esp_opus_dec_decode(server_decoder, &raw, &decoded, nullptr);
+            uint32_t uplink_samples = decoded.decoded_size / sizeof(int16_t);
+            uint32_t resampled = 0;
+            esp_ae_rate_cvt_get_max_out_sample_num(server_resampler, uplink_samples, &resampled);
+            size_t offset = downlink_pcm.size();
+            downlink_pcm.resize(offset + resampled);
+            esp_ae_rate_cvt_process(server_resampler, uplink_pcm.data(), uplink_samples,
+                downlink_pcm.data() + offset, &resampled);
+            downlink_pcm.resize(offset + resampled);
+            audio_service.ReleasePacket(std::move(packet));
+            sent++;
+
+            /* The resampler output drifts by a sample, so downlink frames are cut from a running buffer */
+            size_t frame_samples = server_frame_bytes / sizeof(int16_t);
+            while (downlink_pcm.size() >= frame_samples) {
+                auto downlink = audio_service.AcquireReceivePacket();
+                downlink->sample_rate = options.output_sample_rate;
+                downlink->frame_duration = options.frame_duration_ms;
+                downlink->timestamp = queued * options.frame_duration_ms;
+                downlink->payload.resize(server_packet_bytes);
+                esp_audio_enc_in_frame_t in = {
+                    .buffer = (uint8_t*)downlink_pcm.data(),
+                    .len = (uint32_t)server_frame_bytes,
+                };
+                esp_audio_enc_out_frame_t out = {
+                    .buffer = downlink->payload.data(),
+                    .len = (uint32_t)server_packet_bytes,
+                    .encoded_bytes = 0,
+                };
+                esp_opus_enc_process(server_encoder, &in, &out);
+                downlink->payload.resize(out.encoded_bytes);
+                downlink_pcm.erase(downlink_pcm.begin(), downlink_pcm.begin() + frame_samples);
+
+                int64_t due_us = esp_timer_get_time() + scale_us(options.network_delay_ms + jitter(random));
+                auto position = std::upper_bound(in_flight.begin(), in_flight.end(), due_us,
+                    [](int64_t due, const DelayedPacket& delayed) { return due < delayed.due_us; });
+                in_flight.insert(position, DelayedPacket{due_us, std::move(downlink)});
+                queued++;
+            }
+
+            if (!sound.empty() && (int64_t)sent * options.frame_duration_ms >= next_sound_ms) {
+                audio_service.PlaySound(sound);
+                next_sound_ms += options.sound_interval_ms;
+            }
+        }
+
+        /* Downlink: deliver what arrived, in arrival order */
+        while (!in_flight.empty() && in_flight.front().due_us <= esp_timer_get_time()) {
+            auto packet = std::move(in_flight.front().packet);
+            in_flight.pop_front();
+            packet->origin_time_us = esp_timer_get_time();
+            audio_service.PushPacketToDecodeQueue(std::move(packet), true);
+            delivered++;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+
+    if (sent >= options.frames) {
+        /* Stop capturing, so the send queue does not grow while the playback drains */
+        audio_service.EnableVoiceProcessing(false);
+    }
+    audio_service.WaitForPlaybackQueueEmpty();
+    /* The output task writes the last frame after it left the queue */
+    vTaskDelay(pdMS_TO_TICKS(std::max<int64_t>(scale_us(PLAYBACK_CHUNK_DURATION_MS * 4) / 1000, 5)));
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    auto statistics = audio_service.GetDebugStatistics();
+    uint32_t played = DownlinkCount(audio_service.GetLatencyTracer());
+    audio_service.Stop();
+    esp_opus_dec_close(server_decoder);
+    esp_opus_enc_close(server_encoder);
+    esp_ae_rate_cvt_close(server_resampler);
+
+    double elapsed_s = elapsed_us / 1e6;
+    double audio_s = (double)sent * options.frame_duration_ms / 1000;
+    printf("Looped %d frames of %d ms, speed %.1f, output %d Hz, network %d+%d ms\n", sent,
+        options.frame_duration_ms, options.speed, options.output_sample_rate, options.network_delay_ms, options.jitter_ms);
+    printf("Wall time %.2f s for %.2f s of audio, %.1fx real time\n", elapsed_s, audio_s,
+        elapsed_s > 0 ? audio_s / elapsed_s : 0);
+    printf("Frames/s: input %.1f, encode %.1f, looped back %.1f, played %.1f\n", statistics.input_count / elapsed_s,
+        statistics.encode_count / elapsed_s, delivered / elapsed_s, played / elapsed_s);
+    printf("Jitter buffer: target %lu ms, underruns %lu, late %lu, concealed %lu (FEC %lu, PLC %lu)\n",
+        (unsigned long)statistics.jitter_target_delay_ms, (unsigned long)statistics.jitter_underrun_count,
+        (unsigned long)statistics.jitter_late_packet_count, (unsigned long)statistics.concealed_count,
+        (unsigned long)statistics.fec_recovered_count, (unsigned long)statistics.plc_count);
+    printf("Pools exhausted: encode %lu, playback %lu, packet %lu, receive %lu\n",
+        (unsigned long)statistics.encode_task_pool_exhausted, (unsigned long)statistics.playback_task_pool_exhausted,
+        (unsigned long)statistics.packet_pool_exhausted, (unsigned long)statistics.receive_packet_pool_exhausted);
+
+    printf("\n%-16s %8s %8s\n", "queue depth", "avg", "max");
+    auto print_depth = [depth_samples](const char* name, const DepthStats& depth) {
+        printf("%-16s %8.1f %8lu\n", name, depth_samples > 0 ? (double)depth.sum / depth_samples : 0.0,
+            (unsigned long)depth.max);
+    };
+    print_depth("encode", encode_depth);
+    print_depth("send", send_depth);
+    print_depth("decode", decode_depth);
+    print_depth("playback", playback_depth);
+    print_depth("effects", effects_depth);
+    PrintLatencies(audio_service.GetLatencyTracer());
+    /* The resampler holds back a sample, so the last downlink frame may be one short and not sent */
+    bool complete = sent == options.frames && delivered >= options.frames - 1 && played == (uint32_t)delivered;
+    if (!complete) {
+        printf("\nFAILED: %d frames delivered, %lu played\n", delivered, (unsigned long)played);
+    }
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/*
+ * Compares the capture stage of AudioService::ReadAudioData() with the path it replaced.
+ *
+ * The old path read into a fresh vector, resampled every channel into a second fresh vector, and
+ * left the reader to copy the left channel out into a third one. The new path reads into reused
+ * buffers, picks the left channel in place and resamples only that channel. Both read 10 ms frames
+ * for a 16 kHz mono consumer, like the audio processor, from a synthetic codec that returns at once.
+ *
+ * The output of both paths is compared, and the heap allocations per read are counted.
+ */
+#include "audio_service.h"
+
+#include <board.h>
+#include <esp_log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#define TAG "CaptureResampleBench"
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/* A microphone that is always ready: a tone on the left channel, another one on the right. One second
+ * of it is generated up front, so a read costs a copy like a DMA read does. */
+class SyntheticCodec : public AudioCodec {
+public:
+    SyntheticCodec(int sample_rate, int channels) {
+        input_sample_rate_ = sample_rate;
+        output_sample_rate_ = 16000;
+        input_channels_ = channels;
+        input_settle_ms_ = 0;
+        signal_.resize(sample_rate * channels);
+        for (int i = 0; i < sample_rate; i++) {
+            for (int channel = 0; channel < channels; channel++) {
+                signal_[i * channels + channel] = (int16_t)(8000 * sin(2 * M_PI * (440 + 220 * channel) * i / sample_rate));
+            }
+        }
+    }
+
+private:
+    std::vector<int16_t> signal_;
+    size_t position_ = 0;
+
+    virtual int Read(int16_t* dest, int samples) override {
+        for (int copied = 0; copied < samples;) {
+            size_t count = std::min<size_t>(samples - copied, signal_.size() - position_);
+            memcpy(dest + copied, signal_.data() + position_, count * sizeof(int16_t));
+            copied += count;
+            position_ = (position_ + count) % signal_.size();
+        }
+        return samples;
+    }
+
+    virtual int Write(const int16_t* data, int samples) override {
+        return samples;
+    }
+};
+
+/* ReadAudioData() and the reader's channel pick before the capture stage was fused */
+class OldCapture {
+public:
+    explicit OldCapture(AudioCodec* codec) : codec_(codec) {
+        if (codec->input_sample_rate() != 16000) {
+            esp_ae_rate_cvt_cfg_t cfg = {
+                .src_rate = (uint32_t)codec->input_sample_rate(),
+                .dest_rate = 16000,
+                .channel = (uint8_t)codec->input_channels(),
+                .bits_per_sample = ESP_AUDIO_BIT16,
+                .complexity = 2,
+                .perf_type = ESP_AE_RATE_CVT_PERF_TYPE_SPEED,
+            };
+            esp_ae_rate_cvt_open(&cfg, &resampler_);
+        }
+    }
+
+    ~OldCapture() {
+        if (resampler_ != nullptr) {
+            esp_ae_rate_cvt_close(resampler_);
+        }
+    }
+
+    bool Read(std::vector<int16_t>& mono, int samples) {
+        std::vector<int16_t> data;
+        if (codec_->input_sample_rate() != 16000) {
+            data.resize(samples * codec_->input_sample_rate() / 16000 * codec_->input_channels());
+            if (!codec_->InputData(data)) {
+                return false;
+            }
+            if (resampler_ != nullptr) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                uint32_t in_sample_num = data.size() / codec_->input_channels();
+                uint32_t output_samples = 0;
+                esp_ae_rate_cvt_get_max_out_sample_num(resampler_, in_sample_num, &output_samples);
+                auto resampled = std::vector<int16_t>(output_samples * codec_->input_channels());
+                uint32_t actual_output = output_samples;
+                esp_ae_rate_cvt_process(resampler_, (esp_ae_sample_t)data.data(), in_sample_num,
+                                       (esp_ae_sample_t)resampled.data(), &actual_output);
+                resampled.resize(actual_output * codec_->input_channels());
+                data = std::move(resampled);
+            }
+        } else {
+            data.resize(samples * codec_->input_channels());
+            if (!codec_->InputData(data)) {
+                return false;
+            }
+        }
+
+        if (codec_->input_channels() == 2) {
+            auto mono_data = std::vector<int16_t>(data.size() / 2);
+            for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
+                mono_data[i] = data[j];
+            }
+            mono = std::move(mono_data);
+        } else {
+            mono = std::move(data);
+        }
+        last_input_time_ = std::chrono::steady_clock::now();
+        return true;
+    }
+
+private:
+    AudioCodec* codec_;
+    esp_ae_rate_cvt_handle_t resampler_ = nullptr;
+    std::mutex mutex_;
+    std::chrono::steady_clock::time_point last_input_time_;
+};
+
+struct Result {
+    double us_per_read = 0;
+    double allocations_per_read = 0;
+};
+
+template <typename ReadFunction>
+static Result Measure(int reads, ReadFunction&& read) {
+    /* One read first, so the reused buffers are at their steady size */
+    read();
+    uint64_t allocations_before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++) {
+        if (!read()) {
+            fprintf(stderr, "Read failed\n");
+            exit(1);
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    Result result;
+    result.us_per_read = elapsed / reads;
+    result.allocations_per_read = (double)(allocations.load() - allocations_before) / reads;
+    return result;
+}
+
+/* Returns false if the two paths do not deliver the same samples */
+static bool RunCase(int sample_rate, int channels, int reads) {
+    const int samples = 160;    // 10 ms at 16 kHz
+
+    SyntheticCodec old_codec(sample_rate, channels);
+    SyntheticCodec new_codec(sample_rate, channels);
+    Board::GetInstance().SetAudioCodec(&new_codec);
+    AudioService audio_service;
+    audio_service.Initialize(&new_codec);
+    OldCapture old_capture(&old_codec);
+
+    /* Same input on both sides, so the output must match sample for sample */
+    std::vector<int16_t> old_data;
+    std::vector<int16_t> new_data;
+    bool equal = true;
+    for (int i = 0; i < 100; i++) {
+        old_capture.Read(old_data, samples);
+        audio_service.ReadAudioData(new_data, 16000, samples, 1);
+        equal = equal && old_data == new_data;
+    }
+
+    Result old_result = Measure(reads, [&]() {
+        return old_capture.Read(old_data, samples);
+    });
+    Result new_result = Measure(reads, [&]() {
+        return audio_service.ReadAudioData(new_data, 16000, samples, 1);
+    });
+
+    printf("%6d Hz %-6s  %10.2f %8.1f  %10.2f %8.1f  %6.2fx  %s\n", sample_rate, channels == 1 ? "mono" : "stereo",
+        old_result.us_per_read, old_result.allocations_per_read,
+        new_result.us_per_read, new_result.allocations_per_read,
+        old_result.us_per_read / new_result.us_per_read, equal ? "yes" : "NO");
+    return equal;
+}
+
+int main(int argc, char** argv) {
+    int reads = argc > 1 ? atoi(argv[1]) : 20000;
+    if (reads <= 0) {
+        fprintf(stderr, "Usage: %s [reads]\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    printf("%d reads of 10 ms for a 16 kHz mono reader\n\n", reads);
+    printf("input             old us/read allocs  new us/read allocs  speedup  same output\n");
+    bool equal = true;
+    equal = RunCase(16000, 1, reads) && equal;
+    equal = RunCase(24000, 2, reads) && equal;
+    equal = RunCase(48000, 2, reads) && equal;
+    return equal ? 0 : 1;
+}
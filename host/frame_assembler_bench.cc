@@ -0,0 +1,99 @@
+/*
+ * Re-chunks a sample stream into fixed frames with FrameAssembler and with the vector insert/erase
+ * pattern it replaced, for the input and frame sizes of the AFE feed and fetch paths.
+ *
+ * Both produce the same frames, a checksum over them is compared, and the time is given per frame.
+ */
+#include "frame_assembler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* The old pattern: append at the end, erase each frame from the front */
+class VectorRechunker {
+public:
+    template <typename OnFrame>
+    void Feed(const int16_t* data, size_t count, size_t frame_size, OnFrame&& on_frame) {
+        buffer_.insert(buffer_.end(), data, data + count);
+        while (buffer_.size() >= frame_size) {
+            on_frame(buffer_.data());
+            buffer_.erase(buffer_.begin(), buffer_.begin() + frame_size);
+        }
+    }
+
+private:
+    std::vector<int16_t> buffer_;
+};
+
+class AssemblerRechunker {
+public:
+    AssemblerRechunker(size_t input_size, size_t frame_size) {
+        assembler_.Reserve(input_size + frame_size);
+    }
+
+    template <typename OnFrame>
+    void Feed(const int16_t* data, size_t count, size_t frame_size, OnFrame&& on_frame) {
+        assembler_.Append(data, count);
+        while (const int16_t* frame = assembler_.Peek(frame_size)) {
+            on_frame(frame);
+            assembler_.Consume(frame_size);
+        }
+    }
+
+private:
+    FrameAssembler<int16_t> assembler_;
+};
+
+/* Feeds `total` samples in `input_size` pieces, returns the ns per frame and a checksum of the frames */
+template <typename Rechunker>
+static double Run(Rechunker& rechunker, const std::vector<int16_t>& input, size_t input_size, size_t frame_size,
+    size_t total, uint64_t& checksum) {
+    checksum = 0;
+    size_t frames = 0;
+    auto on_frame = [&](const int16_t* frame) {
+        checksum = checksum * 31 + (uint16_t)frame[0] + (uint16_t)frame[frame_size - 1];
+        frames++;
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (size_t fed = 0; fed + input_size <= total; fed += input_size) {
+        rechunker.Feed(input.data() + fed % (input.size() - input_size), input_size, frame_size, on_frame);
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / std::max<size_t>(frames, 1);
+}
+
+int main(int argc, char** argv) {
+    size_t total = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000000;
+    if (total == 0) {
+        fprintf(stderr, "Usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<int16_t> input(1 << 16);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (int16_t)(i * 7919);
+    }
+
+    const size_t frame_sizes[] = {512, 960};
+    const size_t input_sizes[] = {160, 480, 1024};
+    printf("%zu samples\n\n", total);
+    printf("frame  input   vector ns/frame  assembler ns/frame  speedup  same frames\n");
+    bool same = true;
+    for (size_t frame_size : frame_sizes) {
+        for (size_t input_size : input_sizes) {
+            VectorRechunker vector_rechunker;
+            AssemblerRechunker assembler_rechunker(input_size, frame_size);
+            uint64_t vector_checksum = 0;
+            uint64_t assembler_checksum = 0;
+            double vector_ns = Run(vector_rechunker, input, input_size, frame_size, total, vector_checksum);
+            double assembler_ns = Run(assembler_rechunker, input, input_size, frame_size, total, assembler_checksum);
+            bool equal = vector_checksum == assembler_checksum;
+            same = same && equal;
+            printf("%5zu  %5zu  %16.1f  %18.1f  %6.2fx  %s\n", frame_size, input_size, vector_ns, assembler_ns,
+                vector_ns / assembler_ns, equal ? "yes" : "NO");
+        }
+    }
+    return same ? 0 : 1;
+}
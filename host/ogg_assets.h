@@ -0,0 +1,39 @@
+#ifndef HOST_OGG_ASSETS_H
+#define HOST_OGG_ASSETS_H
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifndef ASSETS_DIR
+#define ASSETS_DIR "main/assets"
+#endif
+
+struct OggAsset {
+    std::string path;
+    std::vector<uint8_t> data;
+};
+
+/* Every .ogg file under the assets directory, sorted by path */
+static inline std::vector<OggAsset> LoadOggAssets(const std::string& dir = ASSETS_DIR) {
+    std::vector<OggAsset> assets;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".ogg") {
+            continue;
+        }
+        std::ifstream file(entry.path(), std::ios::binary);
+        OggAsset asset;
+        asset.path = entry.path().string();
+        asset.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        assets.push_back(std::move(asset));
+    }
+    std::sort(assets.begin(), assets.end(), [](const OggAsset& a, const OggAsset& b) {
+        return a.path < b.path;
+    });
+    return assets;
+}
+
+#endif // HOST_OGG_ASSETS_H
@@ -0,0 +1,62 @@
+/*
+ * Demuxes every bundled OGG sound many times over, with the copying demuxer and in zero-copy mode,
+ * fed in one piece like PlaySound() does and in 512 byte chunks like a stream.
+ */
+#include "ogg_demuxer.h"
+#include "ogg_assets.h"
+
+#include <esp_log.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static volatile uint8_t sink;
+
+static void Run(const std::vector<OggAsset>& assets, int rounds, size_t chunk_size, bool zero_copy) {
+    OggDemuxer demuxer;
+    demuxer.EnableZeroCopy(zero_copy);
+    size_t packets = 0;
+    demuxer.OnDemuxerFinished([&](const uint8_t* packet, int sample_rate, size_t len) {
+        /* Touch the packet like the decoder would */
+        sink = packet[len - 1];
+        packets++;
+    });
+
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto& asset : assets) {
+            demuxer.Reset();
+            size_t size = chunk_size != 0 ? chunk_size : asset.data.size();
+            for (size_t offset = 0; offset < asset.data.size(); offset += size) {
+                demuxer.Process(asset.data.data() + offset, std::min(size, asset.data.size() - offset));
+            }
+            bytes += asset.data.size();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-10s %-8s %10.1f %12.0f %10.1f\n", chunk_size == 0 ? "whole" : "512 bytes", zero_copy ? "yes" : "no",
+        bytes / seconds / 1e6, packets / seconds, seconds * 1e9 / packets);
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    if (rounds <= 0) {
+        fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    auto assets = LoadOggAssets();
+    size_t total = 0;
+    for (const auto& asset : assets) {
+        total += asset.data.size();
+    }
+    printf("%d rounds over %zu files, %zu bytes\n\n", rounds, assets.size(), total);
+    printf("feed       zero copy      MB/s    packets/s  ns/packet\n");
+    Run(assets, rounds, 0, false);
+    Run(assets, rounds, 0, true);
+    Run(assets, rounds, 512, false);
+    Run(assets, rounds, 512, true);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+/*
+ * Host stand-in for the board, it only hands out the codec the harness installed.
+ */
+class AudioCodec;
+
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    AudioCodec* GetAudioCodec() { return audio_codec_; }
+    /// @brief Host only, the codec returned by GetAudioCodec()
+    void SetAudioCodec(AudioCodec* codec) { audio_codec_ = codec; }
+
+private:
+    AudioCodec* audio_codec_ = nullptr;
+};
+
+#endif // HOST_BOARD_H
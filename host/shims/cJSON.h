@@ -0,0 +1,59 @@
+#ifndef HOST_CJSON_H
+#define HOST_CJSON_H
+
+/*
+ * Host stand-in for the part of cJSON the audio pipeline uses: building documents and printing them.
+ */
+#include <cstddef>
+
+#define cJSON_Invalid 0
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON* next;
+    struct cJSON* prev;
+    struct cJSON* child;
+    int type;
+    char* valuestring;
+    int valueint;
+    double valuedouble;
+    char* string;
+} cJSON;
+
+typedef int cJSON_bool;
+
+cJSON* cJSON_CreateObject();
+cJSON* cJSON_CreateArray();
+cJSON* cJSON_CreateNumber(double number);
+cJSON* cJSON_CreateString(const char* string);
+cJSON* cJSON_CreateBool(cJSON_bool boolean);
+void cJSON_Delete(cJSON* item);
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item);
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item);
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number);
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string);
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean);
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* name);
+int cJSON_GetArraySize(const cJSON* array);
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index);
+cJSON_bool cJSON_IsNumber(const cJSON* item);
+cJSON_bool cJSON_IsString(const cJSON* item);
+cJSON_bool cJSON_IsBool(const cJSON* item);
+cJSON_bool cJSON_IsTrue(const cJSON* item);
+cJSON_bool cJSON_IsArray(const cJSON* item);
+cJSON_bool cJSON_IsObject(const cJSON* item);
+
+/// @brief The caller frees the result with cJSON_free()
+char* cJSON_Print(const cJSON* item);
+char* cJSON_PrintUnformatted(const cJSON* item);
+void cJSON_free(void* ptr);
+
+#endif // HOST_CJSON_H
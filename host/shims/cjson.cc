@@ -0,0 +1,213 @@
+#include "cJSON.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static cJSON* NewItem(int type) {
+    auto item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = type;
+    return item;
+}
+
+cJSON* cJSON_CreateObject() {
+    return NewItem(cJSON_Object);
+}
+
+cJSON* cJSON_CreateArray() {
+    return NewItem(cJSON_Array);
+}
+
+cJSON* cJSON_CreateNumber(double number) {
+    auto item = NewItem(cJSON_Number);
+    item->valuedouble = number;
+    item->valueint = (int)number;
+    return item;
+}
+
+cJSON* cJSON_CreateString(const char* string) {
+    auto item = NewItem(cJSON_String);
+    item->valuestring = strdup(string);
+    return item;
+}
+
+cJSON* cJSON_CreateBool(cJSON_bool boolean) {
+    return NewItem(boolean ? cJSON_True : cJSON_False);
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item != nullptr) {
+        auto next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (array == nullptr || item == nullptr) {
+        return 0;
+    }
+    if (array->child == nullptr) {
+        array->child = item;
+        item->prev = item;
+    } else {
+        /* Like cJSON, the first child's prev points at the last one */
+        auto last = array->child->prev;
+        last->next = item;
+        item->prev = last;
+        array->child->prev = item;
+    }
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item) {
+    if (item == nullptr) {
+        return 0;
+    }
+    free(item->string);
+    item->string = strdup(name);
+    return cJSON_AddItemToArray(object, item);
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    auto item = cJSON_CreateNumber(number);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    auto item = cJSON_CreateString(string);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    auto item = cJSON_CreateBool(boolean);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* name) {
+    for (auto item = object != nullptr ? object->child : nullptr; item != nullptr; item = item->next) {
+        if (item->string != nullptr && strcmp(item->string, name) == 0) {
+            return item;
+        }
+    }
+    return nullptr;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int size = 0;
+    for (auto item = array != nullptr ? array->child : nullptr; item != nullptr; item = item->next) {
+        size++;
+    }
+    return size;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    auto item = array != nullptr ? array->child : nullptr;
+    while (item != nullptr && index-- > 0) {
+        item = item->next;
+    }
+    return item;
+}
+
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item != nullptr && item->type == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON* item) { return item != nullptr && item->type == cJSON_String; }
+cJSON_bool cJSON_IsBool(const cJSON* item) { return item != nullptr && (item->type & (cJSON_True | cJSON_False)); }
+cJSON_bool cJSON_IsTrue(const cJSON* item) { return item != nullptr && item->type == cJSON_True; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item != nullptr && item->type == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item != nullptr && item->type == cJSON_Object; }
+
+static void PrintString(std::string& out, const char* string) {
+    out += '"';
+    for (const char* p = string; *p != '\0'; p++) {
+        switch (*p) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default: out += *p; break;
+        }
+    }
+    out += '"';
+}
+
+static void PrintItem(std::string& out, const cJSON* item, bool formatted, int depth) {
+    char number[32];
+    switch (item->type) {
+        case cJSON_False:
+            out += "false";
+            break;
+        case cJSON_True:
+            out += "true";
+            break;
+        case cJSON_NULL:
+            out += "null";
+            break;
+        case cJSON_Number:
+            if (item->valuedouble == std::floor(item->valuedouble) && std::fabs(item->valuedouble) < 1e15) {
+                snprintf(number, sizeof(number), "%lld", (long long)item->valuedouble);
+            } else {
+                snprintf(number, sizeof(number), "%g", item->valuedouble);
+            }
+            out += number;
+            break;
+        case cJSON_String:
+            PrintString(out, item->valuestring);
+            break;
+        case cJSON_Array:
+        case cJSON_Object: {
+            bool object = item->type == cJSON_Object;
+            out += object ? '{' : '[';
+            for (auto child = item->child; child != nullptr; child = child->next) {
+                if (formatted && object) {
+                    out += '\n';
+                    out.append(depth + 1, '\t');
+                }
+                if (object) {
+                    PrintString(out, child->string != nullptr ? child->string : "");
+                    out += formatted ? ":\t" : ":";
+                }
+                PrintItem(out, child, formatted, depth + 1);
+                if (child->next != nullptr) {
+                    out += formatted && !object ? ", " : ",";
+                }
+            }
+            if (formatted && object && item->child != nullptr) {
+                out += '\n';
+                out.append(depth, '\t');
+            }
+            out += object ? '}' : ']';
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static char* Print(const cJSON* item, bool formatted) {
+    if (item == nullptr) {
+        return nullptr;
+    }
+    std::string out;
+    PrintItem(out, item, formatted, 0);
+    return strdup(out.c_str());
+}
+
+char* cJSON_Print(const cJSON* item) {
+    return Print(item, true);
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    return Print(item, false);
+}
+
+void cJSON_free(void* ptr) {
+    free(ptr);
+}
@@ -0,0 +1,6 @@
+#ifndef HOST_DRIVER_I2S_COMMON_H
+#define HOST_DRIVER_I2S_COMMON_H
+
+#include "i2s_std.h"
+
+#endif // HOST_DRIVER_I2S_COMMON_H
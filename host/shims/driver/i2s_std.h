@@ -0,0 +1,7 @@
+#ifndef HOST_DRIVER_I2S_STD_H
+#define HOST_DRIVER_I2S_STD_H
+
+/* Only the handle type, host codecs do not talk to I2S */
+typedef struct i2s_channel_obj_t* i2s_chan_handle_t;
+
+#endif // HOST_DRIVER_I2S_STD_H
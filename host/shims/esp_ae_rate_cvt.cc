@@ -0,0 +1,69 @@
+#include "esp_ae_rate_cvt.h"
+
+#include <vector>
+
+struct HostRateCvt {
+    esp_ae_rate_cvt_cfg_t config;
+    uint64_t phase = 0;                 // Position of the next output sample past the last input one, Q32
+    std::vector<int16_t> last;          // Last input sample of each channel
+};
+
+esp_ae_err_t esp_ae_rate_cvt_open(esp_ae_rate_cvt_cfg_t* cfg, esp_ae_rate_cvt_handle_t* handle) {
+    if (cfg->src_rate == 0 || cfg->dest_rate == 0 || cfg->channel == 0 || cfg->bits_per_sample != 16) {
+        *handle = nullptr;
+        return ESP_AE_ERR_INVALID_PARAMETER;
+    }
+    auto cvt = new HostRateCvt();
+    cvt->config = *cfg;
+    cvt->last.assign(cfg->channel, 0);
+    *handle = cvt;
+    return ESP_AE_ERR_OK;
+}
+
+esp_ae_err_t esp_ae_rate_cvt_get_max_out_sample_num(esp_ae_rate_cvt_handle_t handle, uint32_t in_sample_num,
+    uint32_t* out_sample_num) {
+    *out_sample_num = (uint64_t)in_sample_num * handle->config.dest_rate / handle->config.src_rate + 2;
+    return ESP_AE_ERR_OK;
+}
+
+esp_ae_err_t esp_ae_rate_cvt_process(esp_ae_rate_cvt_handle_t handle, esp_ae_sample_t in_samples,
+    uint32_t in_sample_num, esp_ae_sample_t out_samples, uint32_t* out_sample_num) {
+    auto in = (const int16_t*)in_samples;
+    auto out = (int16_t*)out_samples;
+    int channels = handle->config.channel;
+    uint64_t step = ((uint64_t)handle->config.src_rate << 32) / handle->config.dest_rate;
+    uint64_t end = (uint64_t)in_sample_num << 32;
+    uint32_t count = 0;
+
+    /* Input index -1 is the last sample of the previous call, so output i sits between in[p - 1] and in[p] */
+    uint64_t position = handle->phase;
+    while (position < end && count < *out_sample_num) {
+        uint32_t index = position >> 32;
+        int64_t fraction = (position & 0xffffffffULL) >> 16;
+        for (int c = 0; c < channels; c++) {
+            int32_t a = index == 0 ? handle->last[c] : in[(index - 1) * channels + c];
+            int32_t b = in[index * channels + c];
+            out[count * channels + c] = (int16_t)(a + (((b - a) * fraction) >> 16));
+        }
+        count++;
+        position += step;
+    }
+    if (in_sample_num > 0) {
+        for (int c = 0; c < channels; c++) {
+            handle->last[c] = in[(in_sample_num - 1) * channels + c];
+        }
+    }
+    handle->phase = position >= end ? position - end : 0;
+    *out_sample_num = count;
+    return ESP_AE_ERR_OK;
+}
+
+esp_ae_err_t esp_ae_rate_cvt_reset(esp_ae_rate_cvt_handle_t handle) {
+    handle->phase = 0;
+    handle->last.assign(handle->config.channel, 0);
+    return ESP_AE_ERR_OK;
+}
+
+void esp_ae_rate_cvt_close(esp_ae_rate_cvt_handle_t handle) {
+    delete handle;
+}
@@ -0,0 +1,42 @@
+#ifndef HOST_ESP_AE_RATE_CVT_H
+#define HOST_ESP_AE_RATE_CVT_H
+
+/*
+ * Host stand-in for the esp_audio_effects rate converter, a linear interpolator for 16-bit samples.
+ * It keeps the phase and the last sample between calls, like the real one.
+ */
+#include <cstdint>
+
+typedef void* esp_ae_sample_t;
+typedef struct HostRateCvt* esp_ae_rate_cvt_handle_t;
+
+typedef enum {
+    ESP_AE_ERR_OK = 0,
+    ESP_AE_ERR_FAIL = -1,
+    ESP_AE_ERR_INVALID_PARAMETER = -3,
+} esp_ae_err_t;
+
+typedef enum {
+    ESP_AE_RATE_CVT_PERF_TYPE_MEMORY = 0,
+    ESP_AE_RATE_CVT_PERF_TYPE_SPEED = 1,
+} esp_ae_rate_cvt_perf_type_t;
+
+typedef struct {
+    uint32_t src_rate;
+    uint32_t dest_rate;
+    uint8_t channel;
+    uint8_t bits_per_sample;
+    uint8_t complexity;
+    esp_ae_rate_cvt_perf_type_t perf_type;
+} esp_ae_rate_cvt_cfg_t;
+
+esp_ae_err_t esp_ae_rate_cvt_open(esp_ae_rate_cvt_cfg_t* cfg, esp_ae_rate_cvt_handle_t* handle);
+esp_ae_err_t esp_ae_rate_cvt_get_max_out_sample_num(esp_ae_rate_cvt_handle_t handle, uint32_t in_sample_num,
+    uint32_t* out_sample_num);
+/// @brief Sample counts are per channel, `out_sample_num` holds the room in `out_samples` on entry
+esp_ae_err_t esp_ae_rate_cvt_process(esp_ae_rate_cvt_handle_t handle, esp_ae_sample_t in_samples,
+    uint32_t in_sample_num, esp_ae_sample_t out_samples, uint32_t* out_sample_num);
+esp_ae_err_t esp_ae_rate_cvt_reset(esp_ae_rate_cvt_handle_t handle);
+void esp_ae_rate_cvt_close(esp_ae_rate_cvt_handle_t handle);
+
+#endif // HOST_ESP_AE_RATE_CVT_H
@@ -0,0 +1,25 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+static std::atomic<esp_log_level_t> log_level{ESP_LOG_INFO};
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    if (level > log_level) {
+        return;
+    }
+    static const char letters[] = "NEWIDV";
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%lld) %s: %s\n", letters[level], (long long)(esp_timer_get_time() / 1000), tag, line);
+}
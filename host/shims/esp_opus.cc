@@ -0,0 +1,156 @@
+#include "esp_opus_enc.h"
+#include "esp_opus_dec.h"
+
+#include <cstring>
+
+struct HostOpusEncoder {
+    esp_opus_enc_config_t config;
+    int frame_samples;
+};
+
+struct HostOpusDecoder {
+    esp_opus_dec_cfg_t config;
+    int last_frame_samples;
+};
+
+int esp_opus_host_frame_duration_us(int frame_duration) {
+    static const int durations_us[] = {2500, 5000, 10000, 20000, 40000, 60000, 80000, 100000, 120000};
+    if (frame_duration < 0 || frame_duration >= (int)(sizeof(durations_us) / sizeof(durations_us[0]))) {
+        return 0;
+    }
+    return durations_us[frame_duration];
+}
+
+esp_audio_err_t esp_opus_enc_open(void* cfg, uint32_t cfg_size, void** encoder) {
+    auto config = (const esp_opus_enc_config_t*)cfg;
+    int duration_us = esp_opus_host_frame_duration_us(config->frame_duration);
+    if (cfg_size != sizeof(esp_opus_enc_config_t) || duration_us == 0 || config->bits_per_sample != 16) {
+        *encoder = nullptr;
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+    auto enc = new HostOpusEncoder();
+    enc->config = *config;
+    enc->frame_samples = (int64_t)config->sample_rate * duration_us / 1000000 * config->channel;
+    *encoder = enc;
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_enc_get_frame_size(void* encoder, int* in_size, int* out_size) {
+    auto enc = (HostOpusEncoder*)encoder;
+    *in_size = enc->frame_samples * sizeof(int16_t);
+    *out_size = ESP_OPUS_HOST_MAGIC_SIZE + enc->frame_samples * sizeof(int16_t);
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_enc_process(void* encoder, esp_audio_enc_in_frame_t* in, esp_audio_enc_out_frame_t* out) {
+    auto enc = (HostOpusEncoder*)encoder;
+    uint32_t pcm_size = enc->frame_samples * sizeof(int16_t);
+    if (in->len != pcm_size) {
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+    if (out->len < ESP_OPUS_HOST_MAGIC_SIZE + pcm_size) {
+        return ESP_AUDIO_ERR_BUFF_NOT_ENOUGH;
+    }
+    memcpy(out->buffer, ESP_OPUS_HOST_MAGIC, ESP_OPUS_HOST_MAGIC_SIZE);
+    memcpy(out->buffer + ESP_OPUS_HOST_MAGIC_SIZE, in->buffer, pcm_size);
+    out->encoded_bytes = ESP_OPUS_HOST_MAGIC_SIZE + pcm_size;
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_enc_close(void* encoder) {
+    delete (HostOpusEncoder*)encoder;
+    return ESP_AUDIO_ERR_OK;
+}
+
+/* Duration of a real Opus packet from its TOC byte (RFC 6716, section 3.1) */
+static int OpusPacketDurationUs(const uint8_t* data, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    int config = data[0] >> 3;
+    int frame_us;
+    if (config < 12) {
+        static const int silk_us[] = {10000, 20000, 40000, 60000};
+        frame_us = silk_us[config % 4];
+    } else if (config < 16) {
+        frame_us = config % 2 == 0 ? 10000 : 20000;
+    } else {
+        static const int celt_us[] = {2500, 5000, 10000, 20000};
+        frame_us = celt_us[config % 4];
+    }
+    int frames;
+    switch (data[0] & 0x03) {
+        case 0:
+            frames = 1;
+            break;
+        case 1:
+        case 2:
+            frames = 2;
+            break;
+        default:
+            frames = size >= 2 ? (data[1] & 0x3f) : 0;
+            break;
+    }
+    return frame_us * frames;
+}
+
+esp_audio_err_t esp_opus_dec_open(void* cfg, uint32_t cfg_size, void** decoder) {
+    auto config = (const esp_opus_dec_cfg_t*)cfg;
+    if (cfg_size != sizeof(esp_opus_dec_cfg_t) || config->sample_rate == 0 || config->channel == 0) {
+        *decoder = nullptr;
+        return ESP_AUDIO_ERR_INVALID_PARAMETER;
+    }
+    auto dec = new HostOpusDecoder();
+    dec->config = *config;
+    int duration_us = esp_opus_host_frame_duration_us(config->frame_duration);
+    dec->last_frame_samples = (int64_t)config->sample_rate * (duration_us > 0 ? duration_us : 20000) / 1000000 * config->channel;
+    *decoder = dec;
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_dec_decode(void* decoder, esp_audio_dec_in_raw_t* raw, esp_audio_dec_out_frame_t* out,
+    esp_audio_dec_info_t* info) {
+    auto dec = (HostOpusDecoder*)decoder;
+    bool pcm = raw->frame_recover == ESP_AUDIO_DEC_RECOVERY_NONE && raw->len >= ESP_OPUS_HOST_MAGIC_SIZE &&
+        memcmp(raw->buffer, ESP_OPUS_HOST_MAGIC, ESP_OPUS_HOST_MAGIC_SIZE) == 0;
+    uint32_t samples;
+    if (pcm) {
+        samples = (raw->len - ESP_OPUS_HOST_MAGIC_SIZE) / sizeof(int16_t);
+    } else if (raw->frame_recover == ESP_AUDIO_DEC_RECOVERY_NONE) {
+        int duration_us = OpusPacketDurationUs(raw->buffer, raw->len);
+        if (duration_us == 0) {
+            return ESP_AUDIO_ERR_FAIL;
+        }
+        samples = (int64_t)dec->config.sample_rate * duration_us / 1000000 * dec->config.channel;
+    } else {
+        samples = dec->last_frame_samples;
+    }
+
+    out->needed_size = samples * sizeof(int16_t);
+    if (out->len < out->needed_size) {
+        return ESP_AUDIO_ERR_BUFF_NOT_ENOUGH;
+    }
+    if (pcm) {
+        memcpy(out->buffer, raw->buffer + ESP_OPUS_HOST_MAGIC_SIZE, out->needed_size);
+    } else {
+        memset(out->buffer, 0, out->needed_size);
+    }
+    out->decoded_size = out->needed_size;
+    raw->consumed = raw->len;
+    dec->last_frame_samples = samples;
+    if (info != nullptr) {
+        info->sample_rate = dec->config.sample_rate;
+        info->channel = dec->config.channel;
+        info->bits_per_sample = 16;
+    }
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_dec_reset(void* decoder) {
+    return ESP_AUDIO_ERR_OK;
+}
+
+esp_audio_err_t esp_opus_dec_close(void* decoder) {
+    delete (HostOpusDecoder*)decoder;
+    return ESP_AUDIO_ERR_OK;
+}
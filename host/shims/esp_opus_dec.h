@@ -0,0 +1,27 @@
+#ifndef HOST_ESP_OPUS_DEC_H
+#define HOST_ESP_OPUS_DEC_H
+
+/*
+ * Host stand-in for the esp_audio_codec Opus decoder. Packets from the host encoder decode to their
+ * PCM. Real Opus packets, e.g. from the bundled OGG sounds, decode to silence of the duration their
+ * TOC byte announces, and a lost packet is concealed with a frame of silence.
+ */
+#include "esp_audio_dec.h"
+#include "esp_opus_enc.h"
+
+typedef esp_opus_enc_frame_duration_t esp_opus_dec_frame_duration_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t channel;
+    esp_opus_dec_frame_duration_t frame_duration;
+    bool self_delimited;
+} esp_opus_dec_cfg_t;
+
+esp_audio_err_t esp_opus_dec_open(void* cfg, uint32_t cfg_size, void** decoder);
+esp_audio_err_t esp_opus_dec_decode(void* decoder, esp_audio_dec_in_raw_t* raw, esp_audio_dec_out_frame_t* out,
+    esp_audio_dec_info_t* info);
+esp_audio_err_t esp_opus_dec_reset(void* decoder);
+esp_audio_err_t esp_opus_dec_close(void* decoder);
+
+#endif // HOST_ESP_OPUS_DEC_H
@@ -0,0 +1,55 @@
+#ifndef HOST_ESP_OPUS_ENC_H
+#define HOST_ESP_OPUS_ENC_H
+
+/*
+ * Host stand-in for the esp_audio_codec Opus encoder. There is no Opus on the host, so a "packet" is
+ * ESP_OPUS_HOST_MAGIC followed by the PCM frame, and the decoder turns it back into the same PCM.
+ * The pipeline moves real frame sizes and timings around, but the Opus CPU time is not measured.
+ */
+#include "esp_audio_enc.h"
+
+#define ESP_OPUS_HOST_MAGIC "PCM0"
+#define ESP_OPUS_HOST_MAGIC_SIZE 4
+#define ESP_OPUS_BITRATE_AUTO -1000
+
+typedef enum {
+    ESP_OPUS_ENC_FRAME_DURATION_ARG = -1,
+    ESP_OPUS_ENC_FRAME_DURATION_2_5_MS = 0,
+    ESP_OPUS_ENC_FRAME_DURATION_5_MS = 1,
+    ESP_OPUS_ENC_FRAME_DURATION_10_MS = 2,
+    ESP_OPUS_ENC_FRAME_DURATION_20_MS = 3,
+    ESP_OPUS_ENC_FRAME_DURATION_40_MS = 4,
+    ESP_OPUS_ENC_FRAME_DURATION_60_MS = 5,
+    ESP_OPUS_ENC_FRAME_DURATION_80_MS = 6,
+    ESP_OPUS_ENC_FRAME_DURATION_100_MS = 7,
+    ESP_OPUS_ENC_FRAME_DURATION_120_MS = 8,
+} esp_opus_enc_frame_duration_t;
+
+typedef enum {
+    ESP_OPUS_ENC_APPLICATION_VOIP = 0,
+    ESP_OPUS_ENC_APPLICATION_AUDIO = 1,
+    ESP_OPUS_ENC_APPLICATION_LOWDELAY = 2,
+} esp_opus_enc_application_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint8_t channel;
+    uint8_t bits_per_sample;
+    int bitrate;
+    esp_opus_enc_frame_duration_t frame_duration;
+    esp_opus_enc_application_t application_mode;
+    int complexity;
+    bool enable_fec;
+    bool enable_dtx;
+    bool enable_vbr;
+} esp_opus_enc_config_t;
+
+esp_audio_err_t esp_opus_enc_open(void* cfg, uint32_t cfg_size, void** encoder);
+esp_audio_err_t esp_opus_enc_get_frame_size(void* encoder, int* in_size, int* out_size);
+esp_audio_err_t esp_opus_enc_process(void* encoder, esp_audio_enc_in_frame_t* in, esp_audio_enc_out_frame_t* out);
+esp_audio_err_t esp_opus_enc_close(void* encoder);
+
+/// @brief Duration of a frame_duration value in microseconds, 0 for an invalid one
+int esp_opus_host_frame_duration_us(int frame_duration);
+
+#endif // HOST_ESP_OPUS_ENC_H
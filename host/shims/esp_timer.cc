@@ -0,0 +1,100 @@
+#include "esp_timer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostTimer {
+    esp_timer_create_args_t args;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+    bool running = false;
+    bool deleted = false;
+    uint64_t period_us = 0;     // 0 for a one-shot timer
+    int64_t deadline_us = 0;
+};
+
+static const auto start_time = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+static void TimerLoop(HostTimer* timer) {
+    std::unique_lock<std::mutex> lock(timer->mutex);
+    while (!timer->deleted) {
+        if (!timer->running) {
+            timer->cv.wait(lock);
+            continue;
+        }
+        int64_t wait_us = timer->deadline_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            timer->cv.wait_for(lock, std::chrono::microseconds(wait_us));
+            continue;
+        }
+        if (timer->period_us > 0) {
+            timer->deadline_us += timer->period_us;
+            /* Missed periods are skipped rather than fired back to back */
+            if (timer->deadline_us < esp_timer_get_time()) {
+                timer->deadline_us = esp_timer_get_time() + timer->period_us;
+            }
+        } else {
+            timer->running = false;
+        }
+        /* The callback may stop or restart the timer */
+        lock.unlock();
+        timer->args.callback(timer->args.arg);
+        lock.lock();
+    }
+}
+
+int esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    auto timer = new HostTimer();
+    timer->args = *args;
+    timer->thread = std::thread(TimerLoop, timer);
+    *handle = timer;
+    return 0;
+}
+
+static int Start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (timer->running) {
+        return -1;
+    }
+    timer->running = true;
+    timer->period_us = period_us;
+    timer->deadline_us = esp_timer_get_time() + timeout_us;
+    timer->cv.notify_all();
+    return 0;
+}
+
+int esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return Start(timer, timeout_us, 0);
+}
+
+int esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return Start(timer, period_us, period_us);
+}
+
+int esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (!timer->running) {
+        return -1;
+    }
+    timer->running = false;
+    timer->cv.notify_all();
+    return 0;
+}
+
+int esp_timer_delete(esp_timer_handle_t timer) {
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        timer->deleted = true;
+        timer->cv.notify_all();
+    }
+    timer->thread.join();
+    delete timer;
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+/*
+ * Host stand-in for esp_timer, every timer has its own thread and callbacks run on it.
+ */
+#include <cstdint>
+
+typedef struct HostTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+int esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+int esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+int esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+int esp_timer_stop(esp_timer_handle_t timer);
+/// @brief Must not be called from the timer's own callback
+int esp_timer_delete(esp_timer_handle_t timer);
+/// @brief Microseconds since the process started
+int64_t esp_timer_get_time();
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,22 @@
+#ifndef HOST_ESP_WN_IFACE_H
+#define HOST_ESP_WN_IFACE_H
+
+#include <cstdint>
+
+typedef struct model_iface_data_t model_iface_data_t;
+
+typedef enum {
+    DET_MODE_90 = 0,
+    DET_MODE_95 = 1,
+} det_mode_t;
+
+typedef struct {
+    model_iface_data_t* (*create)(const char* model_name, det_mode_t det_mode);
+    void (*destroy)(model_iface_data_t* model);
+    int (*get_samp_rate)(model_iface_data_t* model);
+    int (*get_samp_chunksize)(model_iface_data_t* model);
+    int (*detect)(model_iface_data_t* model, int16_t* samples);
+    const char* (*get_word_name)(model_iface_data_t* model, int word_index);
+} esp_wn_iface_t;
+
+#endif // HOST_ESP_WN_IFACE_H
@@ -0,0 +1,164 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostTask {
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notify_value = 0;
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+static thread_local HostTask* current_task = nullptr;
+static const auto start_time = std::chrono::steady_clock::now();
+
+/* Threads that were not created here (e.g. main) get their task on first use */
+static HostTask* CurrentTask() {
+    if (current_task == nullptr) {
+        current_task = new HostTask();
+        current_task->name = "host";
+    }
+    return current_task;
+}
+
+/* Task handles are copied around and notified after the task ended, so they are never freed.
+   The handle is stored before the task runs, like FreeRTOS does for a lower priority task. */
+static HostTask* StartTask(TaskFunction_t function, const char* name, void* arg, TaskHandle_t* handle) {
+    auto task = new HostTask();
+    task->name = name != nullptr ? name : "";
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread([task, function, arg]() {
+        current_task = task;
+        function(arg);
+    }).detach();
+    return task;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    StartTask(function, name, arg, handle);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* task_buffer, BaseType_t core) {
+    return StartTask(function, name, arg, nullptr);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* task_buffer) {
+    return StartTask(function, name, arg, nullptr);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return CurrentTask();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return 1;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notify_value++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    auto task = CurrentTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto notified = [task]() { return task->notify_value > 0; };
+    if (ticks == portMAX_DELAY) {
+        task->cv.wait(lock, notified);
+    } else {
+        task->cv.wait_for(lock, std::chrono::milliseconds(ticks), notified);
+    }
+    uint32_t value = task->notify_value;
+    if (value > 0) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [group, bits, wait_for_all]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool met;
+    if (ticks == portMAX_DELAY) {
+        group->cv.wait(lock, satisfied);
+        met = true;
+    } else {
+        met = group->cv.wait_for(lock, std::chrono::milliseconds(ticks), satisfied);
+    }
+    EventBits_t value = group->bits;
+    if (met && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return value;
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+/*
+ * Host stand-in for the FreeRTOS kernel, tasks run on std::thread and one tick is one millisecond.
+ */
+#include <cstddef>
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+typedef struct HostTask* TaskHandle_t;
+typedef struct { uint8_t reserved[64]; } StaticTask_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+#define configMAX_PRIORITIES 25
+
+#endif // HOST_FREERTOS_H
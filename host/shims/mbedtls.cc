@@ -0,0 +1,76 @@
+#include "mbedtls/aes.h"
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cstring>
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    ctx->evp = EVP_CIPHER_CTX_new();
+}
+
+void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    EVP_CIPHER_CTX_free(ctx->evp);
+    ctx->evp = nullptr;
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    const EVP_CIPHER* cipher = keybits == 128 ? EVP_aes_128_ecb() : keybits == 192 ? EVP_aes_192_ecb() :
+        keybits == 256 ? EVP_aes_256_ecb() : nullptr;
+    if (cipher == nullptr || EVP_EncryptInit_ex(ctx->evp, cipher, nullptr, key, nullptr) != 1) {
+        return -1;
+    }
+    EVP_CIPHER_CTX_set_padding(ctx->evp, 0);
+    return 0;
+}
+
+static void IncrementCounter(unsigned char counter[16]) {
+    /* The counter is a 128-bit big-endian number */
+    for (int i = 15; i >= 0; i--) {
+        if (++counter[i] != 0) {
+            break;
+        }
+    }
+}
+
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+    unsigned char stream_block[16], const unsigned char* input, unsigned char* output) {
+    size_t n = *nc_off;
+    if (n > 15) {
+        return -1;
+    }
+    size_t i = 0;
+    while (i < length) {
+        int out_size = 0;
+        if (n == 0 && length - i >= 16) {
+            /* Whole blocks take the keystream of several counter values in one call */
+            unsigned char counters[32 * 16];
+            unsigned char keystream[32 * 16];
+            size_t blocks = std::min<size_t>((length - i) / 16, 32);
+            for (size_t block = 0; block < blocks; block++) {
+                memcpy(counters + block * 16, nonce_counter, 16);
+                IncrementCounter(nonce_counter);
+            }
+            if (EVP_EncryptUpdate(ctx->evp, keystream, &out_size, counters, blocks * 16) != 1) {
+                return -1;
+            }
+            for (size_t j = 0; j < blocks * 16; j++) {
+                output[i + j] = input[i + j] ^ keystream[j];
+            }
+            memcpy(stream_block, keystream + (blocks - 1) * 16, 16);
+            i += blocks * 16;
+            continue;
+        }
+        if (n == 0) {
+            if (EVP_EncryptUpdate(ctx->evp, stream_block, &out_size, nonce_counter, 16) != 1) {
+                return -1;
+            }
+            IncrementCounter(nonce_counter);
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 0x0F;
+        i++;
+    }
+    *nc_off = n;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef HOST_MBEDTLS_AES_H
+#define HOST_MBEDTLS_AES_H
+
+/*
+ * Host stand-in for the mbedtls AES API, on OpenSSL's AES. CTR mode keeps the mbedtls semantics:
+ * the counter block and the offset into the last keystream block carry over between calls.
+ * The ESP32's AES accelerator is not modelled, so the cipher times are the PC's.
+ */
+#include <cstddef>
+
+struct evp_cipher_ctx_st;
+
+typedef struct {
+    evp_cipher_ctx_st* evp;
+} mbedtls_aes_context;
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx);
+void mbedtls_aes_free(mbedtls_aes_context* ctx);
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits);
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+    unsigned char stream_block[16], const unsigned char* input, unsigned char* output);
+
+#endif // HOST_MBEDTLS_AES_H
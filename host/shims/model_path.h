@@ -0,0 +1,22 @@
+#ifndef HOST_MODEL_PATH_H
+#define HOST_MODEL_PATH_H
+
+/*
+ * Host stand-in for the esp-sr model list, the host has no models so no wake word engine starts.
+ */
+#define ESP_MN_PREFIX "mn"
+#define ESP_WN_PREFIX "wn"
+#define ESP_NSNET_PREFIX "nsnet"
+#define ESP_VADN_PREFIX "vadnet"
+
+typedef struct {
+    char** model_name;
+    char** model_info;
+    int num;
+} srmodel_list_t;
+
+srmodel_list_t* esp_srmodel_init(const char* partition_label);
+void esp_srmodel_deinit(srmodel_list_t* models);
+char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2);
+
+#endif // HOST_MODEL_PATH_H
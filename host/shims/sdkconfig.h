@@ -0,0 +1,6 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+/* The host configuration is passed on the compiler command line, see ../CMakeLists.txt */
+
+#endif // HOST_SDKCONFIG_H
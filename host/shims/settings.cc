@@ -0,0 +1,60 @@
+#include "settings.h"
+
+#include <map>
+#include <mutex>
+
+static std::mutex settings_mutex;
+static std::map<std::string, std::string> settings_values;
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    auto it = settings_values.find(ns_ + "." + key);
+    return it != settings_values.end() ? it->second : default_value;
+}
+
+void Settings::SetString(const std::string& key, const std::string& value) {
+    if (!read_write_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    settings_values[ns_ + "." + key] = value;
+}
+
+int Settings::GetInt(const std::string& key, int default_value) {
+    auto value = GetString(key);
+    return value.empty() ? default_value : std::stoi(value);
+}
+
+void Settings::SetInt(const std::string& key, int value) {
+    SetString(key, std::to_string(value));
+}
+
+bool Settings::GetBool(const std::string& key, bool default_value) {
+    return GetInt(key, default_value ? 1 : 0) != 0;
+}
+
+void Settings::SetBool(const std::string& key, bool value) {
+    SetInt(key, value ? 1 : 0);
+}
+
+void Settings::EraseKey(const std::string& key) {
+    if (!read_write_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    settings_values.erase(ns_ + "." + key);
+}
+
+void Settings::EraseAll() {
+    if (!read_write_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    std::string prefix = ns_ + ".";
+    for (auto it = settings_values.begin(); it != settings_values.end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? settings_values.erase(it) : std::next(it);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef HOST_SETTINGS_H
+#define HOST_SETTINGS_H
+
+/*
+ * Host stand-in for the NVS settings, values live in memory for the lifetime of the process.
+ */
+#include <string>
+
+class Settings {
+public:
+    Settings(const std::string& ns, bool read_write = false);
+
+    std::string GetString(const std::string& key, const std::string& default_value = "");
+    void SetString(const std::string& key, const std::string& value);
+    int GetInt(const std::string& key, int default_value = 0);
+    void SetInt(const std::string& key, int value);
+    bool GetBool(const std::string& key, bool default_value = false);
+    void SetBool(const std::string& key, bool value);
+    void EraseKey(const std::string& key);
+    void EraseAll();
+
+private:
+    std::string ns_;
+    bool read_write_;
+};
+
+#endif // HOST_SETTINGS_H
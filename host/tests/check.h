@@ -0,0 +1,38 @@
+#ifndef HOST_TESTS_CHECK_H
+#define HOST_TESTS_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+/* Integers are compared by value, so a size can be checked against a plain literal */
+template <typename A, typename B>
+inline bool CheckEqual(const A& a, const B& b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B> &&
+                  !std::is_same_v<A, bool> && !std::is_same_v<B, bool>) {
+        return std::cmp_equal(a, b);
+    } else {
+        return a == b;
+    }
+}
+
+/* Minimal assertions for the host tests, a failed check prints its location and exits with 1 */
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        auto check_a_ = (a); \
+        auto check_b_ = (b); \
+        if (!CheckEqual(check_a_, check_b_)) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, \
+                (long long)check_a_, (long long)check_b_); \
+            exit(1); \
+        } \
+    } while (0)
+
+#endif // HOST_TESTS_CHECK_H
@@ -0,0 +1,123 @@
+// Reordering and loss cases of the JitterBuffer, driven with explicit times.
+#include "jitter_buffer.h"
+#include "check.h"
+
+#include <cstdio>
+#include <vector>
+
+#define FRAME_MS 60
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sample_rate = 24000;
+    packet->frame_duration = FRAME_MS;
+    packet->sequence = sequence;
+    packet->payload.resize(10);
+    return packet;
+}
+
+static void Put(JitterBuffer& buffer, uint32_t sequence, int64_t now_ms) {
+    CHECK(buffer.Put(MakePacket(sequence), now_ms) == nullptr);
+}
+
+/* Runs Next() until it waits, the decoded sequences are appended and concealed frames as 0 */
+static uint32_t Drain(JitterBuffer& buffer, int64_t now_ms, uint32_t playback_ahead_ms, std::vector<uint32_t>& played) {
+    while (true) {
+        std::unique_ptr<AudioStreamPacket> packet;
+        uint32_t wait_ms = 0;
+        auto action = buffer.Next(now_ms, playback_ahead_ms, packet, wait_ms);
+        if (action == JitterBuffer::kJitterActionWait) {
+            return wait_ms;
+        }
+        played.push_back(action == JitterBuffer::kJitterActionDecode ? packet->sequence : 0);
+    }
+}
+
+/* A steady stream that starts playing right away */
+static void StartSteady(JitterBuffer& buffer, std::vector<uint32_t>& played) {
+    for (uint32_t sequence = 1; sequence <= 3; sequence++) {
+        Put(buffer, sequence, sequence * FRAME_MS);
+        Drain(buffer, sequence * FRAME_MS, 120, played);
+    }
+    CHECK_EQ(played.size(), 3);
+}
+
+static void TestSwappedPairIsPlayed() {
+    JitterBuffer buffer(16, 400);
+    std::vector<uint32_t> played;
+    StartSteady(buffer, played);
+
+    /* 5 overtakes 4 by 10 ms, 4 is waited for */
+    Put(buffer, 5, 5 * FRAME_MS - 10);
+    uint32_t wait_ms = Drain(buffer, 5 * FRAME_MS - 10, 120, played);
+    CHECK_EQ(played.size(), 3);
+    CHECK(wait_ms > 0 && wait_ms <= FRAME_MS);
+
+    Put(buffer, 4, 5 * FRAME_MS);
+    Drain(buffer, 5 * FRAME_MS, 120, played);
+    CHECK((played == std::vector<uint32_t>{1, 2, 3, 4, 5}));
+
+    auto statistics = buffer.statistics();
+    CHECK_EQ(statistics.concealed, 0);
+    CHECK_EQ(statistics.late_packets, 0);
+}
+
+static void TestLostPacketIsConcealedAfterWaiting() {
+    JitterBuffer buffer(16, 400);
+    std::vector<uint32_t> played;
+    StartSteady(buffer, played);
+
+    /* 4 never comes, it is given one frame before 5 is played after it */
+    Put(buffer, 5, 5 * FRAME_MS);
+    uint32_t wait_ms = Drain(buffer, 5 * FRAME_MS, 200, played);
+    CHECK_EQ(played.size(), 3);
+    Drain(buffer, 5 * FRAME_MS + wait_ms, 200, played);
+    CHECK((played == std::vector<uint32_t>{1, 2, 3, 0, 5}));
+    CHECK_EQ(buffer.statistics().concealed, 1);
+
+    /* Arriving after all, it is late */
+    CHECK(buffer.Put(MakePacket(4), 5 * FRAME_MS + wait_ms + 1) != nullptr);
+    CHECK_EQ(buffer.statistics().late_packets, 1);
+}
+
+static void TestStarvingConcealsAtOnce() {
+    JitterBuffer buffer(16, 400);
+    std::vector<uint32_t> played;
+    StartSteady(buffer, played);
+
+    /* The speaker is about to run dry, there is no time to wait for 4 */
+    Put(buffer, 5, 5 * FRAME_MS);
+    uint32_t wait_ms = Drain(buffer, 5 * FRAME_MS, 120, played);
+    CHECK_EQ(played.size(), 3);
+    Drain(buffer, 5 * FRAME_MS + 1, 10, played);
+    CHECK((played == std::vector<uint32_t>{1, 2, 3, 0, 5}));
+
+    /* Waiting is also cut short to when the speaker starts starving */
+    Put(buffer, 7, 6 * FRAME_MS);
+    wait_ms = Drain(buffer, 6 * FRAME_MS, 50, played);
+    CHECK_EQ(wait_ms, 30);
+}
+
+static void TestUnderrunRebuffers() {
+    JitterBuffer buffer(16, 400);
+    std::vector<uint32_t> played;
+    StartSteady(buffer, played);
+
+    /* Empty while the speaker still plays, the decoder checks again when it runs dry */
+    uint32_t wait_ms = Drain(buffer, 4 * FRAME_MS, 100, played);
+    CHECK_EQ(wait_ms, 80);
+    Drain(buffer, 4 * FRAME_MS + 80, 20, played);
+
+    /* A late packet ends the stall, it counts as an underrun */
+    Put(buffer, 4, 4 * FRAME_MS + 200);
+    CHECK_EQ(buffer.statistics().underruns, 1);
+}
+
+int main() {
+    TestSwappedPairIsPlayed();
+    TestLostPacketIsConcealedAfterWaiting();
+    TestStarvingConcealsAtOnce();
+    TestUnderrunRebuffers();
+    printf("jitter_buffer_test passed\n");
+    return 0;
+}
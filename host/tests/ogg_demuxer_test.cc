@@ -0,0 +1,76 @@
+// The OggDemuxer over every bundled OGG sound: zero-copy and chunked feeding give the packets of
+// the copying demuxer fed in one piece.
+#include "ogg_demuxer.h"
+#include "ogg_assets.h"
+#include "check.h"
+
+#include <esp_log.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct Demuxed {
+    std::vector<std::vector<uint8_t>> packets;
+    std::vector<int> sample_rates;
+    size_t in_place = 0;
+};
+
+static Demuxed Demux(const std::vector<uint8_t>& data, size_t chunk_size, bool zero_copy) {
+    Demuxed demuxed;
+    OggDemuxer demuxer;
+    demuxer.EnableZeroCopy(zero_copy);
+    const uint8_t* chunk = nullptr;
+    size_t chunk_len = 0;
+    demuxer.OnDemuxerFinished([&](const uint8_t* packet, int sample_rate, size_t len) {
+        demuxed.packets.emplace_back(packet, packet + len);
+        demuxed.sample_rates.push_back(sample_rate);
+        if (packet >= chunk && packet + len <= chunk + chunk_len) {
+            demuxed.in_place++;
+        }
+    });
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+        chunk = data.data() + offset;
+        chunk_len = std::min(chunk_size, data.size() - offset);
+        demuxer.Process(chunk, chunk_len);
+    }
+    return demuxed;
+}
+
+int main() {
+    esp_log_level_set("*", ESP_LOG_WARN);
+    auto assets = LoadOggAssets();
+    CHECK(!assets.empty());
+
+    const size_t chunk_sizes[] = {1, 7, 100, 4096};
+    size_t packets = 0;
+    size_t in_place = 0;
+    for (const auto& asset : assets) {
+        auto reference = Demux(asset.data, asset.data.size(), false);
+        if (reference.packets.empty()) {
+            fprintf(stderr, "%s: no packets\n", asset.path.c_str());
+        }
+        CHECK(!reference.packets.empty());
+        CHECK_EQ(reference.in_place, 0);
+
+        auto whole = Demux(asset.data, asset.data.size(), true);
+        CHECK(whole.packets == reference.packets);
+        CHECK(whole.sample_rates == reference.sample_rates);
+        packets += whole.packets.size();
+        in_place += whole.in_place;
+
+        for (size_t chunk_size : chunk_sizes) {
+            for (bool zero_copy : {false, true}) {
+                auto chunked = Demux(asset.data, chunk_size, zero_copy);
+                if (chunked.packets != reference.packets) {
+                    fprintf(stderr, "%s: differs in %zu byte chunks, zero copy %d\n", asset.path.c_str(), chunk_size, zero_copy);
+                }
+                CHECK(chunked.packets == reference.packets);
+                CHECK(chunked.sample_rates == reference.sample_rates);
+            }
+        }
+    }
+
+    printf("ogg_demuxer_test passed: %zu files, %zu packets, %zu handed out in place\n", assets.size(), packets, in_place);
+    return 0;
+}
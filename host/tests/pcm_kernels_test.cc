@@ -0,0 +1,73 @@
+// The SIMD paths of PcmKernels against PcmKernels::Scalar, over lengths, offsets and edge values.
+#include "pcm_kernels.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static std::mt19937 rng(1234);
+
+/* Random samples with the extremes mixed in, so every clamp is hit */
+static std::vector<int16_t> RandomPcm(size_t samples) {
+    static const int16_t edges[] = {-32768, -32767, -16384, -1, 0, 1, 16383, 32767};
+    std::uniform_int_distribution<int> value(-32768, 32767);
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        pcm[i] = rng() % 4 == 0 ? edges[rng() % 8] : value(rng);
+    }
+    return pcm;
+}
+
+/* Every length up to a few blocks, and starting off a block boundary */
+template <typename Function>
+static void ForEachLayout(Function&& function) {
+    for (size_t samples = 0; samples <= 70; samples++) {
+        for (size_t offset = 0; offset < 9; offset++) {
+            function(samples, offset);
+        }
+    }
+}
+
+static void TestMix() {
+    const int32_t gains_q15[] = {0, 8192, 32767, 32768, 32769, 65535, -32768};
+    ForEachLayout([&](size_t samples, size_t offset) {
+        auto src = RandomPcm(samples + offset);
+        auto dest = RandomPcm(samples + offset);
+        for (int32_t gain_q15 : gains_q15) {
+            auto expected = dest;
+            auto actual = dest;
+            PcmKernels::Scalar::Mix(src.data() + offset, expected.data() + offset, samples, gain_q15);
+            PcmKernels::Mix(src.data() + offset, actual.data() + offset, samples, gain_q15);
+            CHECK(expected == actual);
+        }
+    });
+}
+
+static void TestExtractChannel() {
+    ForEachLayout([&](size_t frames, size_t offset) {
+        for (int channels : {1, 2, 4}) {
+            auto input = RandomPcm(frames * channels + offset);
+            for (int channel = 0; channel < channels; channel++) {
+                std::vector<int16_t> expected(frames + 1, 7);
+                std::vector<int16_t> actual(frames + 1, 7);
+                PcmKernels::Scalar::ExtractChannel(input.data() + offset, expected.data(), frames, channels, channel);
+                PcmKernels::ExtractChannel(input.data() + offset, actual.data(), frames, channels, channel);
+                CHECK(expected == actual);
+
+                /* In place, as the capture stage does it */
+                auto in_place = input;
+                PcmKernels::ExtractChannel(in_place.data() + offset, in_place.data() + offset, frames, channels, channel);
+                CHECK(memcmp(in_place.data() + offset, expected.data(), frames * sizeof(int16_t)) == 0);
+            }
+        }
+    });
+}
+
+int main() {
+    TestMix();
+    TestExtractChannel();
+    printf("pcm_kernels_test passed\n");
+    return 0;
+}
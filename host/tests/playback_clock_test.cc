@@ -0,0 +1,181 @@
+// Simulates the I2S output DMA behind the PlaybackClock and checks how far the timestamps it
+// reports are from the ones actually audible, with jittered arrivals, underruns and late wakeups.
+#include "playback_clock.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define SAMPLE_RATE 24000
+#define DESCRIPTOR_SAMPLES 240
+#define BUFFER_SAMPLES (6 * DESCRIPTOR_SAMPLES)
+#define CHUNK_SAMPLES 240
+#define FRAME_SAMPLES 1440      // 60 ms
+#define FIRST_TIMESTAMP_MS 1000
+
+/*
+ * The DMA as seen from the speaker: samples play back to back at the sample rate while any are
+ * queued. Once it ran dry it plays silence, and new samples start at the next descriptor boundary.
+ */
+class DmaModel {
+public:
+    /// @brief Samples queued at `time_us`
+    int64_t Queued(int64_t time_us) const {
+        if (runs_.empty() || time_us < runs_.back().start_us) {
+            return runs_.empty() ? 0 : written_ - runs_.back().start_sample;
+        }
+        int64_t played = runs_.back().start_sample + (time_us - runs_.back().start_us) * SAMPLE_RATE / 1000000;
+        return std::max<int64_t>(written_ - played, 0);
+    }
+
+    /// @brief When a write of `samples` that starts at `time_us` returns
+    int64_t WriteReturns(int64_t time_us, int64_t samples) const {
+        int64_t excess = Queued(time_us) + samples - BUFFER_SAMPLES;
+        if (excess <= 0) {
+            return time_us;
+        }
+        /* Blocks until the DMA has played the excess */
+        return time_us + (excess * 1000000 + SAMPLE_RATE - 1) / SAMPLE_RATE;
+    }
+
+    void Write(int64_t time_us, int64_t samples) {
+        if (Queued(time_us) == 0) {
+            int64_t descriptor_us = (int64_t)DESCRIPTOR_SAMPLES * 1000000 / SAMPLE_RATE;
+            int64_t start_us = (time_us + descriptor_us - 1) / descriptor_us * descriptor_us;
+            runs_.push_back({start_us, written_});
+        }
+        written_ += samples;
+        runs_.back().end_sample = written_;
+    }
+
+    /// @brief The sample audible at `time_us`, -1 for silence
+    int64_t PositionAt(int64_t time_us) const {
+        for (auto it = runs_.rbegin(); it != runs_.rend(); ++it) {
+            if (time_us < it->start_us) {
+                continue;
+            }
+            int64_t position = it->start_sample + (time_us - it->start_us) * SAMPLE_RATE / 1000000;
+            return position < it->end_sample ? position : -1;
+        }
+        return -1;
+    }
+
+private:
+    struct Run {
+        int64_t start_us;
+        int64_t start_sample;
+        int64_t end_sample = 0;
+    };
+    std::vector<Run> runs_;
+    int64_t written_ = 0;
+};
+
+struct Result {
+    int compared = 0;
+    int silence_mismatches = 0;
+    int longest_mismatch_ms = 0;
+    int max_error_ms = 0;
+    double mean_error_ms = 0;
+};
+
+/*
+ * Frames arrive every 60 ms plus up to `jitter_ms`, and every `stall_every` frames one arrives
+ * `stall_ms` late, which drains the DMA. Every write that blocked returns up to `wake_delay_ms` late.
+ */
+static Result Simulate(unsigned seed, int jitter_ms, int stall_every, int stall_ms, int wake_delay_ms) {
+    std::mt19937 rng(seed);
+    PlaybackClock clock;
+    clock.Configure(SAMPLE_RATE, BUFFER_SAMPLES, DESCRIPTOR_SAMPLES);
+    DmaModel dma;
+
+    const int frames = 500;
+    std::vector<int64_t> arrivals(frames);
+    int64_t late_us = 0;
+    for (int i = 0; i < frames; i++) {
+        if (stall_every > 0 && i > 0 && i % stall_every == 0) {
+            late_us += stall_ms * 1000;
+        }
+        arrivals[i] = 100000 + i * 60000LL + late_us + (jitter_ms > 0 ? rng() % (jitter_ms * 1000) : 0);
+    }
+    std::sort(arrivals.begin(), arrivals.end());
+
+    Result result;
+    double error_sum = 0;
+    int64_t now_us = 0;
+    int64_t next_query_us = 100000;
+    int64_t last_mismatch_us = 0;
+    int mismatch_ms = 0;
+    for (int i = 0; i < frames; i++) {
+        now_us = std::max(now_us, arrivals[i]);
+        clock.MarkTimestamp(FIRST_TIMESTAMP_MS + i * 60);
+        for (int chunk = 0; chunk < FRAME_SAMPLES / CHUNK_SAMPLES; chunk++) {
+            int64_t start_us = now_us;
+            int64_t returns_us = dma.WriteReturns(start_us, CHUNK_SAMPLES);
+            dma.Write(returns_us, CHUNK_SAMPLES);
+            now_us = returns_us;
+            if (returns_us > start_us && wake_delay_ms > 0) {
+                now_us += rng() % (wake_delay_ms * 1000 + 1);
+            }
+            clock.OnWritten(CHUNK_SAMPLES, start_us, now_us);
+
+            /* The uplink asks for a capture time a frame in the past, like the encoder does */
+            for (; next_query_us < now_us - 60000; next_query_us += 1000) {
+                int64_t position = dma.PositionAt(next_query_us);
+                uint32_t expected = position < 0 ? 0 : FIRST_TIMESTAMP_MS + (uint32_t)(position * 1000 / SAMPLE_RATE);
+                uint32_t actual = clock.TimestampAt(next_query_us);
+                if ((expected == 0) != (actual == 0)) {
+                    result.silence_mismatches++;
+                    mismatch_ms = next_query_us == last_mismatch_us + 1000 ? mismatch_ms + 1 : 1;
+                    last_mismatch_us = next_query_us;
+                    result.longest_mismatch_ms = std::max(result.longest_mismatch_ms, mismatch_ms);
+                    continue;
+                }
+                if (expected == 0) {
+                    continue;
+                }
+                int error_ms = abs((int)(actual - expected));
+                result.max_error_ms = std::max(result.max_error_ms, error_ms);
+                error_sum += error_ms;
+                result.compared++;
+            }
+        }
+    }
+    result.mean_error_ms = result.compared > 0 ? error_sum / result.compared : 0;
+    return result;
+}
+
+int main() {
+    struct Case {
+        const char* name;
+        int jitter_ms;
+        int stall_every;
+        int stall_ms;
+        int wake_delay_ms;
+    };
+    const Case cases[] = {
+        {"steady", 0, 0, 0, 0},
+        {"jitter", 40, 0, 0, 0},
+        {"underruns", 20, 25, 200, 0},
+        {"late wakeups", 20, 0, 0, 5},
+        {"underruns, late wakeups", 40, 25, 200, 5},
+    };
+
+    const int descriptor_ms = DESCRIPTOR_SAMPLES * 1000 / SAMPLE_RATE;
+    printf("case                       compared  max ms  mean ms  bound ms  silence mismatches  longest ms\n");
+    for (const auto& c : cases) {
+        Result result = Simulate(42, c.jitter_ms, c.stall_every, c.stall_ms, c.wake_delay_ms);
+        /* One descriptor of uncertainty after a stall, plus the late wakeup, plus rounding */
+        int bound_ms = descriptor_ms + c.wake_delay_ms + 1;
+        printf("%-26s %8d %7d %8.2f %9d %19d %11d\n", c.name, result.compared, result.max_error_ms,
+            result.mean_error_ms, bound_ms, result.silence_mismatches, result.longest_mismatch_ms);
+        CHECK(result.compared > 20000);
+        CHECK(result.max_error_ms <= bound_ms);
+        /* Around a stall, silence and voice are confused for no longer than the same bound */
+        CHECK(result.longest_mismatch_ms <= bound_ms);
+    }
+    printf("playback_clock_test passed\n");
+    return 0;
+}
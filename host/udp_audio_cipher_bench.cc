@@ -0,0 +1,217 @@
+/*
+ * Compares the AES-CTR framing of the MQTT+UDP audio channel with the code it replaced.
+ *
+ * The old send path copied the nonce into a new string and built each datagram in another new
+ * one. The old receive path let the cipher count up the nonce inside the received datagram and
+ * decrypted into a packet from make_unique. The new path is UdpAudioCipher: the datagram is built
+ * in a buffer that keeps its capacity, the cipher counts up a copy of the nonce on the stack, and
+ * received payloads are decrypted into packets from an ObjectPool, like the receive pool of the
+ * audio service.
+ *
+ * mbedtls is the OpenSSL shim on the host, so the cipher itself runs on the PC's AES. The datagrams
+ * of both paths are compared byte for byte, and the heap allocations per datagram are counted.
+ */
+#include "udp_audio_cipher.h"
+#include "object_pool.h"
+#include "protocol.h"
+
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static const std::string kKey("0123456789abcdef");
+static const std::string kNonce("\x01\x00\x00\x00\x5a\x5a\x5a\x5a\x00\x00\x00\x00\x00\x00\x00\x00", 16);
+
+/* MqttProtocol::SendAudio() and the UDP receive callback before the cipher was factored out */
+class OldCipher {
+public:
+    OldCipher() {
+        mbedtls_aes_init(&aes_ctx_);
+        mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)kKey.c_str(), 128);
+    }
+
+    ~OldCipher() {
+        mbedtls_aes_free(&aes_ctx_);
+    }
+
+    bool Encrypt(const AudioStreamPacket& packet, uint32_t sequence, std::string& out) {
+        std::string nonce(kNonce);
+        *(uint16_t*)&nonce[2] = htons(packet.payload.size());
+        *(uint32_t*)&nonce[8] = htonl(packet.timestamp);
+        *(uint32_t*)&nonce[12] = htonl(sequence);
+
+        std::string encrypted;
+        encrypted.resize(kNonce.size() + packet.payload.size());
+        memcpy(encrypted.data(), nonce.data(), nonce.size());
+
+        size_t nc_off = 0;
+        uint8_t stream_block[16] = {0};
+        if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet.payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
+            (uint8_t*)packet.payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
+            return false;
+        }
+        /* Stands in for udp_->Send(encrypted), the string is gone after the call */
+        out = std::move(encrypted);
+        return true;
+    }
+
+    std::unique_ptr<AudioStreamPacket> Decrypt(const std::string& data) {
+        size_t decrypted_size = data.size() - kNonce.size();
+        size_t nc_off = 0;
+        uint8_t stream_block[16] = {0};
+        auto nonce = (uint8_t*)data.data();
+        auto encrypted = (uint8_t*)data.data() + kNonce.size();
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->payload.resize(decrypted_size);
+        if (mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted,
+            (uint8_t*)packet->payload.data()) != 0) {
+            return nullptr;
+        }
+        return packet;
+    }
+
+private:
+    mbedtls_aes_context aes_ctx_;
+};
+
+struct Result {
+    double ns_per_datagram = 0;
+    double allocations_per_datagram = 0;
+};
+
+template <typename Function>
+static Result Measure(int rounds, Function&& function) {
+    /* One round first, so the reused buffers are at their steady size */
+    function();
+    uint64_t allocations_before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        if (!function()) {
+            fprintf(stderr, "Cipher failed\n");
+            exit(1);
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    Result result;
+    result.ns_per_datagram = elapsed / rounds;
+    result.allocations_per_datagram = (double)(allocations.load() - allocations_before) / rounds;
+    return result;
+}
+
+static void PrintRow(const char* direction, size_t size, const Result& old_result, const Result& new_result, bool equal) {
+    printf("%-8s %5zu  %10.1f %7.1f  %10.1f %7.1f  %6.2fx  %s\n", direction, size,
+        old_result.ns_per_datagram, old_result.allocations_per_datagram,
+        new_result.ns_per_datagram, new_result.allocations_per_datagram,
+        old_result.ns_per_datagram / new_result.ns_per_datagram, equal ? "yes" : "NO");
+}
+
+/* Returns false if the two paths do not produce the same bytes */
+static bool RunCase(size_t payload_size, int rounds) {
+    OldCipher old_cipher;
+    UdpAudioCipher cipher;
+    cipher.SetKey(kKey, kNonce);
+
+    AudioStreamPacket packet;
+    packet.timestamp = 123456;
+    packet.payload.resize(payload_size);
+    for (size_t i = 0; i < payload_size; i++) {
+        packet.payload[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    /* Sending */
+    bool equal = true;
+    std::string old_datagram;
+    std::string new_datagram;
+    for (uint32_t sequence = 1; sequence <= 100; sequence++) {
+        old_cipher.Encrypt(packet, sequence, old_datagram);
+        cipher.Encrypt(packet.payload.data(), packet.payload.size(), packet.timestamp, sequence, new_datagram);
+        equal = equal && old_datagram == new_datagram;
+    }
+    bool send_equal = equal;
+
+    uint32_t old_sequence = 0;
+    Result old_send = Measure(rounds, [&]() {
+        return old_cipher.Encrypt(packet, ++old_sequence, old_datagram);
+    });
+    uint32_t new_sequence = 0;
+    Result new_send = Measure(rounds, [&]() {
+        return cipher.Encrypt(packet.payload.data(), packet.payload.size(), packet.timestamp, ++new_sequence,
+            new_datagram);
+    });
+    PrintRow("send", payload_size, old_send, new_send, send_equal);
+
+    /* Receiving, both decrypt what was sent back to the payload */
+    ObjectPool<AudioStreamPacket> pool;
+    pool.Initialize(8, []() {
+        return std::make_unique<AudioStreamPacket>();
+    });
+    std::string received = new_datagram;
+    std::string old_received = received;
+    auto old_packet = old_cipher.Decrypt(old_received);
+    auto new_packet = pool.Acquire();
+    new_packet->payload.resize(received.size() - UdpAudioCipher::kNonceSize);
+    bool receive_equal = old_packet != nullptr &&
+        cipher.Decrypt((const uint8_t*)received.data(), received.size(), new_packet->payload.data()) &&
+        old_packet->payload.size() == payload_size && new_packet->payload.size() == payload_size &&
+        memcmp(old_packet->payload.data(), packet.payload.data(), payload_size) == 0 &&
+        memcmp(new_packet->payload.data(), packet.payload.data(), payload_size) == 0;
+    pool.Release(std::move(new_packet));
+
+    Result old_receive = Measure(rounds, [&]() {
+        /* The old path counts up the nonce inside the datagram, put it back for the next round */
+        memcpy(old_received.data(), received.data(), UdpAudioCipher::kNonceSize);
+        return old_cipher.Decrypt(old_received) != nullptr;
+    });
+    Result new_receive = Measure(rounds, [&]() {
+        auto packet = pool.Acquire();
+        packet->payload.resize(received.size() - UdpAudioCipher::kNonceSize);
+        bool ok = cipher.Decrypt((const uint8_t*)received.data(), received.size(), packet->payload.data());
+        pool.Release(std::move(packet));
+        return ok;
+    });
+    PrintRow("receive", payload_size, old_receive, new_receive, receive_equal);
+    return send_equal && receive_equal;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (rounds <= 0) {
+        fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%d datagrams per row, AES-128-CTR on the host's AES\n\n", rounds);
+    printf("         bytes  old ns/dgram allocs  new ns/dgram allocs  speedup  same bytes\n");
+    bool equal = true;
+    /* A 60 ms Opus frame at 16 kHz, and a protocol version 4 datagram of three of them */
+    equal = RunCase(160, rounds) && equal;
+    equal = RunCase(3 * 160 + 14, rounds) && equal;
+    return equal ? 0 : 1;
+}
@@ -83,6 +83,9 @@ void Application::Initialize() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+    callbacks.on_end_of_speech = [this]() {
+        xEventGroupSetBits(event_group_, MAIN_EVENT_END_OF_SPEECH);
+    };
     audio_service_.SetCallbacks(callbacks);
 
     // Add state change listeners
@@ -178,6 +181,7 @@ void Application::Run() {
         MAIN_EVENT_TOGGLE_CHAT |
         MAIN_EVENT_START_LISTENING |
         MAIN_EVENT_STOP_LISTENING |
+        MAIN_EVENT_END_OF_SPEECH |
         MAIN_EVENT_ACTIVATION_DONE |
         MAIN_EVENT_STATE_CHANGED;
 
@@ -217,9 +221,18 @@ void Application::Run() {
             HandleStopListeningEvent();
         }
 
+        if (bits & MAIN_EVENT_END_OF_SPEECH) {
+            HandleEndOfSpeechEvent();
+        }
+
         if (bits & MAIN_EVENT_SEND_AUDIO) {
             while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
+                bool sent = !protocol_ || protocol_->SendAudio(*packet);
+                if (sent) {
+                    audio_service_.RecordPacketSent(*packet);
+                }
+                audio_service_.ReleasePacket(std::move(packet));
+                if (!sent) {
                     break;
                 }
             }
@@ -486,6 +499,7 @@ void Application::InitializeProtocol() {
         protocol_ = std::make_unique<MqttProtocol>();
     }
 
+    protocol_->SetFrameDuration(OPUS_FRAME_DURATION_MS);
     protocol_->OnConnected([this]() {
         DismissAlert();
     });
@@ -495,14 +509,22 @@ void Application::InitializeProtocol() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
     
+    protocol_->SetPacketAllocator([this]() {
+        return audio_service_.AcquireReceivePacket();
+    });
     protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
-        if (GetDeviceState() == kDeviceStateSpeaking) {
+        if (GetDeviceState() == kDeviceStateSpeaking && !aborted_) {
+            packet->origin_time_us = esp_timer_get_time();
             audio_service_.PushPacketToDecodeQueue(std::move(packet));
+        } else {
+            audio_service_.ReleaseReceivePacket(std::move(packet));
         }
     });
     
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
         board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
+        audio_service_.EnableDecoderFec(protocol_->server_fec());
+        audio_service_.SetEncodeFrameDuration(protocol_->frame_duration());
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -525,6 +547,8 @@ void Application::InitializeProtocol() {
             auto state = cJSON_GetObjectItem(root, "state");
             if (strcmp(state->valuestring, "start") == 0) {
                 Schedule([this]() {
+                    // The first reply frame follows shortly, have the output open by then
+                    audio_service_.PowerUpOutput();
                     aborted_ = false;
                     SetDeviceState(kDeviceStateSpeaking);
                 });
@@ -693,6 +717,8 @@ void Application::HandleToggleChatEvent() {
     }
 
     if (state == kDeviceStateIdle) {
+        // Let the microphone settle while the channel opens
+        audio_service_.PowerUpInput();
         ListeningMode mode = GetDefaultListeningMode();
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
@@ -717,6 +743,8 @@ void Application::ContinueOpenAudioChannel(ListeningMode mode) {
     }
 
     if (!protocol_->IsAudioChannelOpened()) {
+        // The server hello and the first reply follow, open the output while waiting for them
+        audio_service_.PowerUpOutput();
         if (!protocol_->OpenAudioChannel()) {
             return;
         }
@@ -743,6 +771,7 @@ void Application::HandleStartListeningEvent() {
     }
     
     if (state == kDeviceStateIdle) {
+        audio_service_.PowerUpInput();
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
             // Schedule to let the state change be processed first (UI update)
@@ -773,6 +802,18 @@ void Application::HandleStopListeningEvent() {
     }
 }
 
+void Application::HandleEndOfSpeechEvent() {
+    // The user may have barged in or the mode changed since the endpointer fired
+    if (GetDeviceState() != kDeviceStateListening || listening_mode_ != kListeningModeAutoStop) {
+        return;
+    }
+    ESP_LOGI(TAG, "End of speech detected on the device");
+    if (protocol_) {
+        protocol_->SendStopListening();
+    }
+    SetDeviceState(kDeviceStateIdle);
+}
+
 void Application::HandleWakeWordDetectedEvent() {
     if (!protocol_) {
         return;
@@ -781,6 +822,8 @@ void Application::HandleWakeWordDetectedEvent() {
     auto state = GetDeviceState();
     auto wake_word = audio_service_.GetLastWakeWord();
     ESP_LOGI(TAG, "Wake word detected: %s (state: %d)", wake_word.c_str(), (int)state);
+    // Usually still on from the detection, the turn that follows needs it either way
+    audio_service_.PowerUpInput();
 
     if (state == kDeviceStateIdle) {
         audio_service_.EncodeWakeWord();
@@ -800,7 +843,9 @@ void Application::HandleWakeWordDetectedEvent() {
     } else if (state == kDeviceStateSpeaking || state == kDeviceStateListening) {
         AbortSpeaking(kAbortReasonWakeWordDetected);
         // Clear send queue to avoid sending residues to server
-        while (audio_service_.PopPacketFromSendQueue());
+        while (auto packet = audio_service_.PopPacketFromSendQueue()) {
+            audio_service_.ReleasePacket(std::move(packet));
+        }
 
         if (state == kDeviceStateListening) {
             protocol_->SendStartListening(GetDefaultListeningMode());
@@ -826,6 +871,7 @@ void Application::ContinueWakeWordInvoke(const std::string& wake_word) {
     }
 
     if (!protocol_->IsAudioChannelOpened()) {
+        audio_service_.PowerUpOutput();
         if (!protocol_->OpenAudioChannel()) {
             audio_service_.EnableWakeWordDetection(true);
             return;
@@ -836,7 +882,8 @@ void Application::ContinueWakeWordInvoke(const std::string& wake_word) {
 #if CONFIG_SEND_WAKE_WORD_DATA
     // Encode and send the wake word data to the server
     while (auto packet = audio_service_.PopWakeWordPacket()) {
-        protocol_->SendAudio(std::move(packet));
+        protocol_->SendAudio(*packet);
+        audio_service_.ReleasePacket(std::move(packet));
     }
     // Set the chat state to wake word detected
     protocol_->SendWakeWordDetected(wake_word);
@@ -868,6 +915,10 @@ void Application::HandleStateChangedEvent() {
             display->ClearChatMessages();  // Clear messages first
             display->SetEmotion("neutral"); // Then set emotion (wechat mode checks child count)
             audio_service_.EnableVoiceProcessing(false);
+            // Listening may have ended without SendStopListening(), send the frames of the last batch
+            if (protocol_) {
+                protocol_->FlushAudio();
+            }
             audio_service_.EnableWakeWordDetection(true);
             break;
         case kDeviceStateConnecting:
@@ -889,6 +940,9 @@ void Application::HandleStateChangedEvent() {
                 
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
+#if CONFIG_AUDIO_ENDPOINTER
+                audio_service_.EnableEndpointer(listening_mode_ == kListeningModeAutoStop);
+#endif
                 audio_service_.EnableVoiceProcessing(true);
             }
 
@@ -911,6 +965,8 @@ void Application::HandleStateChangedEvent() {
 
             if (listening_mode_ != kListeningModeRealtime) {
                 audio_service_.EnableVoiceProcessing(false);
+                // The server ended the turn, send the frames of the last batch
+                protocol_->FlushAudio();
                 // Only AFE wake word can be detected in speaking mode
                 audio_service_.EnableWakeWordDetection(audio_service_.IsAfeWakeWord());
             }
@@ -937,6 +993,8 @@ void Application::Schedule(std::function<void()>&& callback) {
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
+    // Stop playback locally right away instead of waiting for the server to stop sending
+    audio_service_.ResetDecoder();
     if (protocol_) {
         protocol_->SendAbortSpeaking(reason);
     }
@@ -1024,6 +1082,7 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
     auto state = GetDeviceState();
     
     if (state == kDeviceStateIdle) {
+        audio_service_.PowerUpInput();
         audio_service_.EncodeWakeWord();
 
         if (!protocol_->IsAudioChannelOpened()) {
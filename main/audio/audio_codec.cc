@@ -3,6 +3,7 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cstring>
 #include <driver/i2s_common.h>
 
@@ -14,14 +15,41 @@ AudioCodec::AudioCodec() {
 AudioCodec::~AudioCodec() {
 }
 
-void AudioCodec::OutputData(std::vector<int16_t>& data) {
-    Write(data.data(), data.size());
+void AudioCodec::OutputData(const int16_t* data, int samples) {
+    if (output_unmute_time_us_ != 0 && esp_timer_get_time() >= output_unmute_time_us_) {
+        output_unmute_time_us_ = 0;
+        MuteOutput(false);
+    }
+    Write(data, samples);
+}
+
+void AudioCodec::FlushOutput() {
+    if (!output_enabled_) {
+        return;
+    }
+    /* The DMA keeps playing what it holds, so keep the DAC muted until the whole ring went out */
+    MuteOutput(true);
+    output_unmute_time_us_ = esp_timer_get_time() + output_buffer_duration_us();
 }
 
-bool AudioCodec::InputData(std::vector<int16_t>& data) {
-    int samples = Read(data.data(), data.size());
-    if (samples > 0) {
-        return true;
+int AudioCodec::InputData(int16_t* dest, int samples) {
+    int read = Read(dest, samples);
+    if (!input_ready_ && read > 0) {
+        int64_t now_us = esp_timer_get_time();
+        if (InputSettled(dest, read) || now_us >= input_enable_time_us_ + input_settle_ms_ * 1000) {
+            input_ready_ = true;
+            input_ready_time_us_ = now_us;
+        }
+    }
+    return read;
+}
+
+bool AudioCodec::InputSettled(const int16_t* data, int samples) {
+    /* The DMA delivers zeros until the ADC puts out its first conversions */
+    for (int i = 0; i < samples; i++) {
+        if (data[i] != 0) {
+            return true;
+        }
     }
     return false;
 }
@@ -55,6 +83,11 @@ void AudioCodec::EnableInput(bool enable) {
         return;
     }
     input_enabled_ = enable;
+    if (enable) {
+        input_enable_time_us_ = esp_timer_get_time();
+        input_ready_ = input_settle_ms_ <= 0;
+        input_ready_time_us_ = input_ready_ ? input_enable_time_us_ : 0;
+    }
     ESP_LOGI(TAG, "Set input enable to %s", enable ? "true" : "false");
 }
 
@@ -13,6 +13,9 @@
 
 #define AUDIO_CODEC_DMA_DESC_NUM 6
 #define AUDIO_CODEC_DMA_FRAME_NUM 240
+/* The longest the ADC path may take to settle after it is enabled. A codec that has not reported
+ * settled samples by then is taken as settled, codecs may override it */
+#define AUDIO_CODEC_INPUT_SETTLE_MS 120
 
 class AudioCodec {
 public:
@@ -24,8 +27,14 @@ public:
     virtual void EnableInput(bool enable);
     virtual void EnableOutput(bool enable);
 
-    virtual void OutputData(std::vector<int16_t>& data);
-    virtual bool InputData(std::vector<int16_t>& data);
+    /// @brief Write straight from the caller's buffer, e.g. a pooled frame or part of one
+    void OutputData(const int16_t* data, int samples);
+    void OutputData(const std::vector<int16_t>& data) { OutputData(data.data(), data.size()); }
+    /// @brief Silence whatever is still queued in the output DMA, called by the output task on abort
+    virtual void FlushOutput();
+    /// @brief Read into the caller's buffer, returns the samples read
+    int InputData(int16_t* dest, int samples);
+    bool InputData(std::vector<int16_t>& data) { return InputData(data.data(), data.size()) > 0; }
     virtual void Start();
 
     inline bool duplex() const { return duplex_; }
@@ -38,6 +47,16 @@ public:
     inline float input_gain() const { return input_gain_; }
     inline bool input_enabled() const { return input_enabled_; }
     inline bool output_enabled() const { return output_enabled_; }
+    /// @brief Whether the enabled input delivers settled samples, found out by InputData()
+    inline bool input_ready() const { return input_ready_; }
+    /// @brief When the input was last enabled
+    inline int64_t input_enable_time_us() const { return input_enable_time_us_; }
+    /// @brief When InputData() found the input settled, 0 before
+    inline int64_t input_ready_time_us() const { return input_ready_time_us_; }
+    /// @brief How long the output DMA ring plays when it is full
+    inline int64_t output_buffer_duration_us() const {
+        return output_sample_rate_ > 0 ? (int64_t)AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM * 1000000 / output_sample_rate_ : 0;
+    }
 
 protected:
     i2s_chan_handle_t tx_handle_ = nullptr;
@@ -53,9 +72,20 @@ protected:
     int output_channels_ = 1;
     int output_volume_ = 70;
     float input_gain_ = 0.0;
+    int input_settle_ms_ = AUDIO_CODEC_INPUT_SETTLE_MS;
+    // Cleared by the base EnableInput(), after the derived codec has opened its input
+    bool input_ready_ = true;
+    int64_t input_enable_time_us_ = 0;
+    int64_t input_ready_time_us_ = 0;
+    // Set by the base FlushOutput(), the next write after this time unmutes the output
+    int64_t output_unmute_time_us_ = 0;
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
+    /// @brief Whether a block read while the input settles is settled, by default the first one that is not all zeros
+    virtual bool InputSettled(const int16_t* data, int samples);
+    /// @brief Mute the DAC without closing it, used by the base FlushOutput()
+    virtual void MuteOutput(bool mute) {}
 };
 
 #endif // _AUDIO_CODEC_H
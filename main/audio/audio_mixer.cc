@@ -0,0 +1,93 @@
+#include "audio_mixer.h"
+#include "pcm_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define AUDIO_MIXER_UNITY_Q15 32768
+/* About -10 dB, speech stays intelligible under a popup */
+#define AUDIO_MIXER_DEFAULT_DUCKING 0.3f
+
+static int32_t GainToQ15(float gain) {
+    return (int32_t)(std::min(std::max(gain, 0.0f), 1.0f) * AUDIO_MIXER_UNITY_Q15 + 0.5f);
+}
+
+AudioMixer::AudioMixer() : ducking_q15_(GainToQ15(AUDIO_MIXER_DEFAULT_DUCKING)) {
+    for (int i = 0; i < kAudioMixerBusCount; i++) {
+        target_gain_q15_[i] = AUDIO_MIXER_UNITY_Q15;
+        gain_q15_[i] = AUDIO_MIXER_UNITY_Q15;
+    }
+}
+
+void AudioMixer::SetGain(AudioMixerBus bus, float gain) {
+    if (bus < 0 || bus >= kAudioMixerBusCount) {
+        return;
+    }
+    target_gain_q15_[bus] = GainToQ15(gain);
+}
+
+void AudioMixer::SetDucking(float gain) {
+    ducking_q15_ = GainToQ15(gain);
+}
+
+const int16_t* AudioMixer::Mix(const int16_t* voice, const int16_t* effects, int16_t* dest, size_t samples) {
+    int32_t voice_target = target_gain_q15_[kAudioMixerBusVoice];
+    if (effects != nullptr) {
+        voice_target = (voice_target * ducking_q15_ + 0x4000) >> 15;
+    }
+    int32_t effects_target = target_gain_q15_[kAudioMixerBusEffects];
+
+    /* A silent bus jumps to its target, there is nothing to ramp */
+    int32_t& voice_gain = gain_q15_[kAudioMixerBusVoice];
+    int32_t& effects_gain = gain_q15_[kAudioMixerBusEffects];
+    if (voice == nullptr) {
+        voice_gain = voice_target;
+    }
+    if (effects == nullptr) {
+        effects_gain = effects_target;
+    }
+
+    if (voice != nullptr && effects == nullptr && voice_gain == AUDIO_MIXER_UNITY_Q15 &&
+        voice_target == AUDIO_MIXER_UNITY_Q15) {
+        return voice;
+    }
+
+    if (voice != nullptr) {
+        Accumulate(voice, dest, samples, voice_gain, voice_target, false);
+        voice_gain = voice_target;
+    }
+    if (effects != nullptr) {
+        Accumulate(effects, dest, samples, effects_gain, effects_target, voice != nullptr);
+        effects_gain = effects_target;
+    }
+    if (voice == nullptr && effects == nullptr) {
+        memset(dest, 0, samples * sizeof(int16_t));
+    }
+    return dest;
+}
+
+void AudioMixer::Accumulate(const int16_t* src, int16_t* dest, size_t samples, int32_t from_q15, int32_t to_q15, bool add) {
+    if (from_q15 == to_q15) {
+        if (add) {
+            PcmKernels::Mix(src, dest, samples, to_q15);
+        } else {
+            if (dest != src) {
+                memcpy(dest, src, samples * sizeof(int16_t));
+            }
+            PcmKernels::Scale(dest, samples, to_q15);
+        }
+        return;
+    }
+
+    /* Linear ramp, the gain carries 8 extra fraction bits so the steps add up over the chunk */
+    int32_t gain = from_q15 << 8;
+    int32_t step = ((to_q15 - from_q15) << 8) / (int32_t)std::max<size_t>(samples, 1);
+    for (size_t i = 0; i < samples; i++) {
+        gain += step;
+        int32_t value = (src[i] * (gain >> 8) + 0x4000) >> 15;
+        if (add) {
+            value += dest[i];
+        }
+        dest[i] = (int16_t)std::min<int32_t>(std::max<int32_t>(value, -32767), 32767);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum AudioMixerBus {
+    kAudioMixerBusVoice,    // Server TTS
+    kAudioMixerBusEffects,  // UI sounds played with PlaySound()
+    kAudioMixerBusCount,
+};
+
+/*
+ * Mixes the voice and effects buses of the output task, one chunk at a time.
+ *
+ * Each bus has its own gain, and the voice bus is ducked while an effect is playing. A gain change
+ * ramps over one chunk, so ducking and volume steps do not click.
+ *
+ * Mix() is called by the output task only, the gains may be set from any task.
+ */
+class AudioMixer {
+public:
+    AudioMixer();
+
+    /// @brief Linear gain of a bus, 0.0 to 1.0
+    void SetGain(AudioMixerBus bus, float gain);
+    /// @brief Gain applied on top of the voice gain while the effects bus plays, 1.0 disables ducking
+    void SetDucking(float gain);
+
+    /// @brief Mix one chunk, either bus may be null when it has nothing to play
+    /// @return `voice` itself when it passes through unchanged, `dest` otherwise
+    const int16_t* Mix(const int16_t* voice, const int16_t* effects, int16_t* dest, size_t samples);
+
+private:
+    std::atomic<int32_t> target_gain_q15_[kAudioMixerBusCount];
+    std::atomic<int32_t> ducking_q15_;
+    // Owned by Mix()
+    int32_t gain_q15_[kAudioMixerBusCount];
+
+    static void Accumulate(const int16_t* src, int16_t* dest, size_t samples, int32_t from_q15, int32_t to_q15, bool add);
+};
+
+#endif // AUDIO_MIXER_H
@@ -13,11 +13,14 @@ public:
     virtual ~AudioProcessor() = default;
     
     virtual void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) = 0;
-    virtual void Feed(std::vector<int16_t>&& data) = 0;
+    virtual void SetFrameDuration(int frame_duration_ms) = 0;
+    /// @brief Microphone samples, interleaved when the codec has more than one input channel
+    virtual void Feed(const int16_t* data, size_t samples) = 0;
     virtual void Start() = 0;
     virtual void Stop() = 0;
     virtual bool IsRunning() = 0;
-    virtual void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) = 0;
+    /// @brief Called with each processed frame, the frame is only valid during the call
+    virtual void OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) = 0;
     virtual void OnVadStateChange(std::function<void(bool speaking)> callback) = 0;
     virtual size_t GetFeedSize() = 0;
     virtual void EnableDeviceAec(bool enable) = 0;
@@ -1,6 +1,9 @@
 #include "audio_service.h"
 #include <esp_log.h>
+#include <algorithm>
+#include <cinttypes>
 #include <cstring>
+#include "pcm_kernels.h"
 
 #define RATE_CVT_CFG(_src_rate, _dest_rate, _channel)        \
     (esp_ae_rate_cvt_cfg_t)                                  \
@@ -37,8 +40,19 @@
 
 #define TAG "AudioService"
 
+static inline BaseType_t TaskCoreId(int core) {
+    return core < 0 ? tskNO_AFFINITY : core;
+}
+
+static inline void NotifyTask(TaskHandle_t task) {
+    if (task != nullptr) {
+        xTaskNotifyGive(task);
+    }
+}
+
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODER_TASK_STOPPED | AS_EVENT_DECODER_TASK_STOPPED);
 }
 
 AudioService::~AudioService() {
@@ -54,34 +68,66 @@ AudioService::~AudioService() {
     if (input_resampler_ != nullptr) {
         esp_ae_rate_cvt_close(input_resampler_);
     }
+    if (input_mono_resampler_ != nullptr) {
+        esp_ae_rate_cvt_close(input_mono_resampler_);
+    }
     if (output_resampler_ != nullptr) {
         esp_ae_rate_cvt_close(output_resampler_);
     }
+    CloseSoundDecoder();
 }
 
 void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
 
-    esp_opus_dec_cfg_t opus_dec_cfg = OPUS_DEC_CFG(codec->output_sample_rate(), OPUS_FRAME_DURATION_MS);
+    /* Servers send 60ms frames unless their hello says otherwise */
+    esp_opus_dec_cfg_t opus_dec_cfg = OPUS_DEC_CFG(codec->output_sample_rate(), OPUS_MAX_FRAME_DURATION_MS);
     auto ret = esp_opus_dec_open(&opus_dec_cfg, sizeof(esp_opus_dec_cfg_t), &opus_decoder_);
     if (opus_decoder_ == nullptr) {
         ESP_LOGE(TAG, "Failed to create audio decoder, error code: %d", ret);
     } else {
         decoder_sample_rate_ = codec->output_sample_rate();
-        decoder_duration_ms_ = OPUS_FRAME_DURATION_MS;
-        decoder_frame_size_ = decoder_sample_rate_ / 1000 * OPUS_FRAME_DURATION_MS;
-    }
-    esp_opus_enc_config_t opus_enc_cfg = AS_OPUS_ENC_CONFIG();
-    ret = esp_opus_enc_open(&opus_enc_cfg, sizeof(esp_opus_enc_config_t), &opus_encoder_);
-    if (opus_encoder_ == nullptr) {
-        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", ret);
-    } else {
-        encoder_sample_rate_ = 16000;
-        encoder_duration_ms_ = OPUS_FRAME_DURATION_MS;
-        esp_opus_enc_get_frame_size(opus_encoder_, &encoder_frame_size_, &encoder_outbuf_size_);
-        encoder_frame_size_ = encoder_frame_size_ / sizeof(int16_t);
+        decoder_duration_ms_ = OPUS_MAX_FRAME_DURATION_MS;
+        decoder_frame_size_ = decoder_sample_rate_ / 1000 * OPUS_MAX_FRAME_DURATION_MS;
     }
+    encoder_sample_rate_ = 16000;
+    OpenEncoder(OPUS_FRAME_DURATION_MS, complexity_governor_.complexity());
+
+    /* Preallocate the frames so the steady state does not touch the heap */
+    size_t encode_pcm_size = encoder_sample_rate_ / 1000 * OPUS_MIN_FRAME_DURATION_MS;
+    size_t playback_pcm_size = codec->output_sample_rate() / 1000 * OPUS_MIN_FRAME_DURATION_MS;
+    size_t payload_size = encoder_outbuf_size_;
+    encode_task_pool_.Initialize(ENCODE_TASK_POOL_SIZE, [encode_pcm_size]() {
+        auto task = std::make_unique<AudioTask>();
+        task->pcm.reserve(encode_pcm_size);
+        return task;
+    });
+    playback_task_pool_.Initialize(PLAYBACK_TASK_POOL_SIZE, [playback_pcm_size]() {
+        auto task = std::make_unique<AudioTask>();
+        task->pcm.reserve(playback_pcm_size);
+        return task;
+    });
+    packet_pool_.Initialize(AUDIO_PACKET_POOL_SIZE, [payload_size]() {
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->payload.SetHeadroom(AUDIO_PACKET_HEADROOM);
+        packet->payload.reserve(payload_size);
+        return packet;
+    });
+    /* Most of these are only used with short frames, so payloads grow on first use and keep their capacity */
+    receive_packet_pool_.Initialize(RECEIVE_PACKET_POOL_SIZE, []() {
+        return std::make_unique<AudioStreamPacket>();
+    });
+    decode_buffer_.reserve(std::max<size_t>(decoder_frame_size_,
+        codec->output_sample_rate() / 1000 * OPUS_MAX_FRAME_DURATION_MS));
+    /* Both chunks start on a 16-byte boundary, so the SIMD path of PcmKernels::Mix() can take them */
+    chunk_samples_ = std::max(1, codec->output_sample_rate() * PLAYBACK_CHUNK_DURATION_MS / 1000);
+    size_t chunk_stride = (chunk_samples_ + 7) & ~(size_t)7;
+    chunk_storage_.resize(chunk_stride * 2 + 8);
+    effects_chunk_ = (int16_t*)(((uintptr_t)chunk_storage_.data() + 15) & ~(uintptr_t)15);
+    mix_chunk_ = effects_chunk_ + chunk_stride;
+    playback_clock_.Configure(codec->output_sample_rate(),
+        AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM, AUDIO_CODEC_DMA_FRAME_NUM);
 
     if (codec->input_sample_rate() != 16000) {
         esp_ae_rate_cvt_cfg_t input_resampler_cfg = RATE_CVT_CFG(
@@ -90,6 +136,16 @@ void AudioService::Initialize(AudioCodec* codec) {
         if (input_resampler_ == nullptr) {
             ESP_LOGE(TAG, "Failed to create input resampler, error code: %d", resampler_ret);
         }
+        /* Readers that only need the left channel resample it alone */
+        if (codec->input_channels() > 1) {
+            esp_ae_rate_cvt_cfg_t mono_resampler_cfg = RATE_CVT_CFG(
+                codec->input_sample_rate(), ESP_AUDIO_SAMPLE_RATE_16K, ESP_AUDIO_MONO);
+            resampler_ret = esp_ae_rate_cvt_open(&mono_resampler_cfg, &input_mono_resampler_);
+            if (input_mono_resampler_ == nullptr) {
+                ESP_LOGE(TAG, "Failed to create mono input resampler, error code: %d", resampler_ret);
+            }
+        }
+        capture_buffer_.reserve(codec->input_sample_rate() / 1000 * OPUS_MAX_FRAME_DURATION_MS * codec->input_channels());
     }
 
 #if CONFIG_USE_AUDIO_PROCESSOR
@@ -98,8 +154,11 @@ void AudioService::Initialize(AudioCodec* codec) {
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
 
-    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+    audio_processor_->OnOutput([this](const int16_t* data, size_t samples) {
+        if (!EndpointUplinkFrame(samples)) {
+            return;
+        }
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, data, samples);
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -124,7 +183,8 @@ void AudioService::Initialize(AudioCodec* codec) {
 
 void AudioService::Start() {
     service_stopped_ = false;
-    xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING);
+    xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+        AS_EVENT_ENCODER_TASK_STOPPED | AS_EVENT_DECODER_TASK_STOPPED);
 
     esp_timer_start_periodic(audio_power_timer_, 1000000);
 
@@ -133,6 +193,7 @@ void AudioService::Start() {
     xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->AudioInputTask();
+        audio_service->audio_input_task_handle_ = nullptr;
         vTaskDelete(NULL);
     }, "audio_input", 2048 * 3, this, 8, &audio_input_task_handle_, 0);
 
@@ -140,6 +201,7 @@ void AudioService::Start() {
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->AudioOutputTask();
+        audio_service->audio_output_task_handle_ = nullptr;
         vTaskDelete(NULL);
     }, "audio_output", 2048 * 2, this, 4, &audio_output_task_handle_);
 #else
@@ -147,6 +209,7 @@ void AudioService::Start() {
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->AudioInputTask();
+        audio_service->audio_input_task_handle_ = nullptr;
         vTaskDelete(NULL);
     }, "audio_input", 2048 * 2, this, 8, &audio_input_task_handle_);
 
@@ -154,61 +217,115 @@ void AudioService::Start() {
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->AudioOutputTask();
+        audio_service->audio_output_task_handle_ = nullptr;
         vTaskDelete(NULL);
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
-    xTaskCreate([](void* arg) {
+    /* Start the opus decoder and encoder tasks, so a slow encode never delays playback */
+    xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusDecoderTask();
+        audio_service->opus_decoder_task_handle_ = nullptr;
+        xEventGroupSetBits(audio_service->event_group_, AS_EVENT_DECODER_TASK_STOPPED);
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 12, this, 2, &opus_codec_task_handle_);
+    }, "opus_decoder", 2048 * 8, this, CONFIG_AUDIO_DECODER_TASK_PRIORITY, &opus_decoder_task_handle_,
+        TaskCoreId(CONFIG_AUDIO_DECODER_TASK_CORE));
+
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncoderTask();
+        audio_service->opus_encoder_task_handle_ = nullptr;
+        xEventGroupSetBits(audio_service->event_group_, AS_EVENT_ENCODER_TASK_STOPPED);
+        vTaskDelete(NULL);
+    }, "opus_encoder", 2048 * 12, this, CONFIG_AUDIO_ENCODER_TASK_PRIORITY, &opus_encoder_task_handle_,
+        TaskCoreId(CONFIG_AUDIO_ENCODER_TASK_CORE));
 }
 
 void AudioService::Stop() {
     esp_timer_stop(audio_power_timer_);
+
+    /* The consumer tasks release the flushed items before they exit */
+    audio_encode_queue_.Flush();
+    audio_decode_queue_.Flush();
+    audio_playback_queue_.Flush();
+    audio_testing_queue_.Flush();
+    audio_sound_queue_.Flush();
+    audio_effects_queue_.Flush();
+
     service_stopped_ = true;
     xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
         AS_EVENT_WAKE_WORD_RUNNING |
-        AS_EVENT_AUDIO_PROCESSOR_RUNNING);
-
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+        AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+        AS_EVENT_ENCODE_QUEUE_AVAILABLE |
+        AS_EVENT_DECODE_QUEUE_AVAILABLE |
+        AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+    NotifyTask(opus_decoder_task_handle_);
+    NotifyTask(opus_encoder_task_handle_);
+    NotifyTask(audio_output_task_handle_);
+
+    /* Wait for the codec tasks to leave their loops, so a following Start() never runs two consumers */
+    EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_ENCODER_TASK_STOPPED | AS_EVENT_DECODER_TASK_STOPPED,
+        pdFALSE, pdTRUE, pdMS_TO_TICKS(AUDIO_CODEC_TASK_STOP_TIMEOUT_MS));
+    if ((bits & (AS_EVENT_ENCODER_TASK_STOPPED | AS_EVENT_DECODER_TASK_STOPPED)) !=
+        (AS_EVENT_ENCODER_TASK_STOPPED | AS_EVENT_DECODER_TASK_STOPPED)) {
+        ESP_LOGW(TAG, "Timed out waiting for the codec tasks to stop, bits: %" PRIx32, bits);
+    }
 }
 
-bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
+bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples, int channels) {
     if (!codec_->input_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableInput(true);
+        EnsureInputPowered(false);
     }
 
-    if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
+    int input_channels = codec_->input_channels();
+    bool left_only = channels == 1 && input_channels > 1;
+    bool resample = codec_->input_sample_rate() != sample_rate;
+
+    /* Read into the caller's buffer unless it has to be resampled, the buffers keep their capacity between calls */
+    std::unique_lock<std::mutex> lock(input_resampler_mutex_, std::defer_lock);
+    if (resample) {
+        lock.lock();
+    }
+    std::vector<int16_t>& raw = resample ? capture_buffer_ : data;
+    size_t in_samples = resample ? samples * codec_->input_sample_rate() / sample_rate : samples;
+    raw.resize(in_samples * input_channels);
+
+    /* Drop what the codec captures while it settles after a power-up, the codec tells when the
+     * samples have settled and the block that did is kept */
+    bool settling = !codec_->input_ready();
+    int64_t wait_start_us = settling ? esp_timer_get_time() : 0;
+    do {
+        if (codec_->InputData(raw.data(), raw.size()) <= 0) {
             return false;
         }
-        if (input_resampler_ != nullptr) {
-            std::lock_guard<std::mutex> lock(input_resampler_mutex_);
-            uint32_t in_sample_num = data.size() / codec_->input_channels();
+    } while (!codec_->input_ready());
+    if (settling) {
+        debug_statistics_.input_warmup_ms = (codec_->input_ready_time_us() - codec_->input_enable_time_us()) / 1000;
+        debug_statistics_.input_warmup_wait_ms = (esp_timer_get_time() - wait_start_us) / 1000;
+        ESP_LOGI(TAG, "Input settled %" PRIu32 " ms after the power-up, the read waited %" PRIu32 " ms",
+            debug_statistics_.input_warmup_ms, debug_statistics_.input_warmup_wait_ms);
+    }
+
+    /* Pick the left channel in place before resampling, so only the needed channel is resampled */
+    if (left_only) {
+        PcmKernels::ExtractChannel(raw.data(), raw.data(), in_samples, input_channels, 0);
+        raw.resize(in_samples);
+    }
+
+    if (resample) {
+        int out_channels = left_only ? 1 : input_channels;
+        auto resampler = left_only ? input_mono_resampler_ : input_resampler_;
+        if (resampler == nullptr) {
+            data.assign(raw.begin(), raw.end());
+        } else {
             uint32_t output_samples = 0;
-            esp_ae_rate_cvt_get_max_out_sample_num(input_resampler_, in_sample_num, &output_samples);
-            auto resampled = std::vector<int16_t>(output_samples * codec_->input_channels());
+            esp_ae_rate_cvt_get_max_out_sample_num(resampler, in_samples, &output_samples);
+            data.resize(output_samples * out_channels);
             uint32_t actual_output = output_samples;
-            esp_ae_rate_cvt_process(input_resampler_, (esp_ae_sample_t)data.data(), in_sample_num,
-                                   (esp_ae_sample_t)resampled.data(), &actual_output);
-            resampled.resize(actual_output * codec_->input_channels());
-            data = std::move(resampled);
-        }
-    } else {
-        data.resize(samples * codec_->input_channels());
-        if (!codec_->InputData(data)) {
-            return false;
+            esp_ae_rate_cvt_process(resampler, (esp_ae_sample_t)raw.data(), in_samples,
+                                   (esp_ae_sample_t)data.data(), &actual_output);
+            data.resize(actual_output * out_channels);
         }
     }
 
@@ -228,6 +345,8 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 }
 
 void AudioService::AudioInputTask() {
+    /* Reused for every read, the consumers below only borrow it */
+    std::vector<int16_t> data;
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
@@ -236,31 +355,17 @@ void AudioService::AudioInputTask() {
         if (service_stopped_) {
             break;
         }
-        if (audio_input_need_warmup_) {
-            audio_input_need_warmup_ = false;
-            vTaskDelay(pdMS_TO_TICKS(120));
-            continue;
-        }
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.size() * encoder_duration_ms_ >= AUDIO_TESTING_MAX_DURATION_MS) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
-            if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
-                if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
-                }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+            int samples = encoder_duration_ms_ * 16000 / 1000;
+            if (ReadAudioData(data, 16000, samples, 1)) {
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, data.data(), data.size());
                 continue;
             }
         }
@@ -268,19 +373,19 @@ void AudioService::AudioInputTask() {
         /* Feed the wake word and/or audio processor */
         if (bits & (AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING)) {
             int samples = 160; // 10ms
-            std::vector<int16_t> data;
             if (ReadAudioData(data, 16000, samples)) {
+                last_capture_time_us_ = LatencyTracer::Now();
                 if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-                    wake_word_->Feed(data);
+                    wake_word_->Feed(data.data(), data.size());
                 }
                 if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-                    audio_processor_->Feed(std::move(data));
+                    audio_processor_->Feed(data.data(), data.size());
                 }
                 continue;
             }
         }
 
-        ESP_LOGE(TAG, "Should not be here, bits: %lx", bits);
+        ESP_LOGE(TAG, "Should not be here, bits: %" PRIx32, bits);
         break;
     }
 
@@ -288,161 +393,514 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
-        if (service_stopped_) {
-            break;
+    auto release_playback_task = [this](std::unique_ptr<AudioTask>&& task) {
+        playback_task_pool_.Release(std::move(task));
+    };
+    uint32_t abort_generation = playback_abort_generation_;
+    // Until then the output DMA may still hold samples that were written before an abort
+    int64_t output_busy_until_us = 0;
+
+    /* The effects frame being played, pulled across frame boundaries a chunk at a time */
+    std::unique_ptr<AudioTask> effect;
+    size_t effect_offset = 0;
+    auto pull_effects = [&](size_t samples) {
+        size_t filled = 0;
+        while (filled < samples) {
+            if (effect == nullptr) {
+                if (!audio_effects_queue_.Pop(effect)) {
+                    break;
+                }
+                effect_offset = 0;
+                NotifyTask(opus_decoder_task_handle_);
+            }
+            size_t count = std::min(samples - filled, effect->pcm.size() - effect_offset);
+            std::copy_n(effect->pcm.data() + effect_offset, count, effects_chunk_ + filled);
+            filled += count;
+            effect_offset += count;
+            if (effect_offset >= effect->pcm.size()) {
+                playback_task_pool_.Release(std::move(effect));
+            }
         }
+        return filled;
+    };
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+    while (!service_stopped_) {
+        if (abort_generation != playback_abort_generation_) {
+            abort_generation = playback_abort_generation_;
+            if (esp_timer_get_time() < output_busy_until_us) {
+                codec_->FlushOutput();
+                playback_clock_.Reset(esp_timer_get_time());
+                output_busy_until_us = 0;
+                playback_dry_time_us_ = 0;
+                uint32_t latency_us = esp_timer_get_time() - playback_abort_time_us_;
+                debug_statistics_.playback_abort_count++;
+                debug_statistics_.abort_to_silence_us = latency_us;
+                debug_statistics_.max_abort_to_silence_us = std::max(debug_statistics_.max_abort_to_silence_us, latency_us);
+                ESP_LOGI(TAG, "Playback aborted, silent after %" PRIu32 " us", latency_us);
+            }
+        }
+
+        if (audio_playback_queue_.Reclaim(release_playback_task) > 0) {
+            NotifyTask(opus_decoder_task_handle_);
+        }
+        if (audio_effects_queue_.Reclaim(release_playback_task) > 0) {
+            NotifyTask(opus_decoder_task_handle_);
+        }
+
+        std::unique_ptr<AudioTask> task;
+        bool has_voice = audio_playback_queue_.Pop(task);
+        bool has_effects = effect != nullptr || !audio_effects_queue_.empty();
+        if (!has_voice && !has_effects) {
+            if (IsPlaybackDrained()) {
+                xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+            }
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (has_voice) {
+            int64_t frame_us = (int64_t)task->pcm.size() * 1000000 / codec_->output_sample_rate();
+            playback_dry_time_us_ = std::max<int64_t>(playback_dry_time_us_, esp_timer_get_time()) + frame_us;
+            NotifyTask(opus_decoder_task_handle_);
+        }
+        if (IsPlaybackDrained()) {
+            xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+        }
 
         if (!codec_->output_enabled()) {
-            esp_timer_stop(audio_power_timer_);
-            esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-            codec_->EnableOutput(true);
+            EnsureOutputPowered(false);
         }
 
-        codec_->OutputData(task->pcm);
+        /* Write in short chunks, so an abort does not wait for the rest of the frame and a sound
+         * starts within a chunk. Without voice, one chunk of effects is played per round. */
+        const size_t chunk_samples = chunk_samples_;
+        const size_t total_samples = has_voice ? task->pcm.size() : chunk_samples;
+        size_t written = 0;
+#if CONFIG_USE_SERVER_AEC
+        playback_clock_.MarkTimestamp(has_voice ? task->timestamp : 0);
+#endif
+        while (written < total_samples && abort_generation == playback_abort_generation_) {
+            size_t samples = std::min(chunk_samples, total_samples - written);
+            size_t effect_samples = pull_effects(samples);
+            if (!has_voice) {
+                if (effect_samples == 0) {
+                    break;
+                }
+                samples = effect_samples;
+            } else if (effect_samples > 0 && effect_samples < samples) {
+                std::fill(effects_chunk_ + effect_samples, effects_chunk_ + samples, 0);
+            }
+            const int16_t* voice = has_voice ? task->pcm.data() + written : nullptr;
+            const int16_t* effects = effect_samples > 0 ? effects_chunk_ : nullptr;
+            const int16_t* mixed = audio_mixer_.Mix(voice, effects, mix_chunk_, samples);
+#if CONFIG_USE_SERVER_AEC
+            int64_t write_start_us = esp_timer_get_time();
+#endif
+            codec_->OutputData(mixed, samples);
+#if CONFIG_USE_SERVER_AEC
+            playback_clock_.OnWritten(samples, write_start_us, esp_timer_get_time());
+#endif
+            written += samples;
+            output_busy_until_us = esp_timer_get_time() + codec_->output_buffer_duration_us();
+            if (has_voice) {
+                playback_dry_time_us_ = output_busy_until_us +
+                    (int64_t)(total_samples - written) * 1000000 / codec_->output_sample_rate();
+            }
+        }
+        if (!has_voice) {
+            last_output_time_ = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (written < total_samples) {
+            playback_task_pool_.Release(std::move(task));
+            continue;
+        }
+        latency_tracer_.Record(kLatencyStagePlayback, task->stage_time_us);
+        latency_tracer_.Record(kLatencyStageDownlink, task->origin_time_us);
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
         debug_statistics_.playback_count++;
-
-#if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
-        }
-#endif
+        playback_task_pool_.Release(std::move(task));
     }
 
+    audio_playback_queue_.Reclaim(release_playback_task);
+    audio_effects_queue_.Reclaim(release_playback_task);
+    playback_task_pool_.Release(std::move(effect));
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
-        if (service_stopped_) {
-            break;
+void AudioService::OpusDecoderTask() {
+    auto release_packet = [this](std::unique_ptr<AudioStreamPacket>&& packet) {
+        receive_packet_pool_.Release(std::move(packet));
+    };
+    auto release_sound_frame = [this](SoundFrame&& frame) {
+        packet_pool_.Release(std::move(frame.packet));
+    };
+    uint32_t jitter_reset_generation = jitter_reset_generation_;
+
+    while (!service_stopped_) {
+        if (jitter_reset_generation != jitter_reset_generation_) {
+            jitter_reset_generation = jitter_reset_generation_;
+            jitter_buffer_.Reset(release_packet);
+        }
+        if (audio_decode_queue_.Reclaim(release_packet) > 0) {
+            xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
         }
+        audio_sound_queue_.Reclaim(release_sound_frame);
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
+        /* Sounds go to the effects bus first, they never wait behind the voice */
+        while (DecodeSoundToEffectsQueue()) {
+        }
+        /* A sound that was cut or flushed never gets its last frame, its decoder is closed once PlaySound() is done */
+        if (sound_decoder_ != nullptr && audio_sound_queue_.empty()) {
+            std::unique_lock<std::mutex> producer_lock(sound_producer_mutex_, std::try_to_lock);
+            if (producer_lock.owns_lock() && audio_sound_queue_.empty()) {
+                sound_cache_.AbortFill();
+                CloseSoundDecoder();
+            }
+        }
 
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
+        /* Move the arrived packets into the jitter buffer right away, so their arrival time is accurate */
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        std::unique_ptr<AudioStreamPacket> packet;
+        bool received = false;
+        while (!jitter_buffer_.full() && audio_decode_queue_.Pop(packet)) {
+            received = true;
+            receive_packet_pool_.Release(jitter_buffer_.Put(std::move(packet), now_ms));
+        }
+        if (received) {
+            xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+        }
 
+        /* Wait for the output task if the playback queue is full */
+        if (audio_playback_queue_.full() ||
+            audio_playback_queue_.size() * decoder_duration_ms_ >= MAX_PLAYBACK_QUEUE_DURATION_MS) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        /* What is queued plus what the output task still writes and the codec still holds */
+        uint32_t playback_ahead_ms = audio_playback_queue_.size() * decoder_duration_ms_ +
+            std::max<int64_t>(playback_dry_time_us_ - esp_timer_get_time(), 0) / 1000;
+        uint32_t wait_ms = 0;
+        auto action = jitter_buffer_.Next(now_ms, playback_ahead_ms, packet, wait_ms);
+        if (action == JitterBuffer::kJitterActionWait) {
+            if (IsPlaybackDrained()) {
+                xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+            }
+            ulTaskNotifyTake(pdTRUE, wait_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms) + 1);
+            continue;
+        }
+
+        if (action == JitterBuffer::kJitterActionDecode) {
+            if (IsPlaybackDrained()) {
+                xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+            }
+            latency_tracer_.Record(kLatencyStageJitterBuffer, packet->stage_time_us);
             SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_ != nullptr) {
-                task->pcm.resize(decoder_frame_size_);
-                esp_audio_dec_in_raw_t raw = {
-                    .buffer = (uint8_t *)(packet->payload.data()),
-                    .len = (uint32_t)(packet->payload.size()),
-                    .consumed = 0,
-                    .frame_recover = ESP_AUDIO_DEC_RECOVERY_NONE,
-                };
-                esp_audio_dec_out_frame_t out_frame = {
-                    .buffer = (uint8_t *)(task->pcm.data()),
-                    .len = (uint32_t)(task->pcm.size() * sizeof(int16_t)),
-                    .decoded_size = 0,
-                };
-                esp_audio_dec_info_t dec_info = {};
-                std::unique_lock<std::mutex> decoder_lock(decoder_mutex_);
-                auto ret = esp_opus_dec_decode(opus_decoder_, &raw, &out_frame, &dec_info);
-                decoder_lock.unlock();
-                if (ret == ESP_AUDIO_ERR_OK) {
-                    task->pcm.resize(out_frame.decoded_size / sizeof(int16_t));
-                    if (decoder_sample_rate_ != codec_->output_sample_rate() && output_resampler_ != nullptr) {
-                        uint32_t target_size = 0;
-                        esp_ae_rate_cvt_get_max_out_sample_num(output_resampler_, task->pcm.size(), &target_size);
-                        std::vector<int16_t> resampled(target_size);
-                        uint32_t actual_output = target_size;
-                        esp_ae_rate_cvt_process(output_resampler_, (esp_ae_sample_t)task->pcm.data(), task->pcm.size(),
-                                                (esp_ae_sample_t)resampled.data(), &actual_output);
-                        resampled.resize(actual_output);
-                        task->pcm = std::move(resampled);
-                    }
-                    lock.lock();
-                    audio_playback_queue_.push_back(std::move(task));
-                    audio_queue_cv_.notify_all();
-                    debug_statistics_.decode_count++;
-                } else {
-                    ESP_LOGE(TAG, "Failed to decode audio after resize, error code: %d", ret);
-                    lock.lock();
-                }
-            } else {
-                ESP_LOGE(TAG, "Audio decoder is not configured");
-                lock.lock();
+            DecodeToPlaybackQueue(packet.get(), false);
+            receive_packet_pool_.Release(std::move(packet));
+        } else {
+            /* With in-band FEC the lost frame is rebuilt from the next packet, otherwise it is extrapolated */
+            const AudioStreamPacket* next = decoder_fec_enabled_ ? jitter_buffer_.Peek() : nullptr;
+            if (next != nullptr && DecodeToPlaybackQueue(next, true)) {
+                debug_statistics_.fec_recovered_count++;
+            } else if (DecodeToPlaybackQueue(nullptr, true)) {
+                debug_statistics_.plc_count++;
+            }
+        }
+    }
+
+    jitter_buffer_.Reset(release_packet);
+    audio_decode_queue_.Reclaim(release_packet);
+    audio_sound_queue_.Reclaim(release_sound_frame);
+    cached_sound_.reset();
+    sound_cache_.AbortFill();
+    CloseSoundDecoder();
+    ESP_LOGW(TAG, "Opus decoder task stopped");
+}
+
+bool AudioService::DecodeToPlaybackQueue(const AudioStreamPacket* packet, bool recover) {
+    auto task = playback_task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = packet != nullptr && !recover ? packet->timestamp : 0;
+    /* Concealed frames are not traced, they did not come from the network */
+    task->origin_time_us = packet != nullptr && !recover ? packet->origin_time_us : 0;
+    int64_t decode_start_us = LatencyTracer::Now();
+    bool decoded_frame = false;
+
+    if (opus_decoder_ != nullptr) {
+        /* Decode straight into the playback frame unless it has to be resampled first */
+        bool need_resample = decoder_sample_rate_ != codec_->output_sample_rate() && output_resampler_ != nullptr;
+        std::vector<int16_t>& decoded = need_resample ? decode_buffer_ : task->pcm;
+        decoded.resize(decoder_frame_size_);
+        esp_audio_dec_in_raw_t raw = {
+            .buffer = packet != nullptr ? (uint8_t *)(packet->payload.data()) : nullptr,
+            .len = packet != nullptr ? (uint32_t)(packet->payload.size()) : 0,
+            .consumed = 0,
+            .frame_recover = recover ? ESP_AUDIO_DEC_RECOVERY_PLC : ESP_AUDIO_DEC_RECOVERY_NONE,
+        };
+        esp_audio_dec_out_frame_t out_frame = {
+            .buffer = (uint8_t *)(decoded.data()),
+            .len = (uint32_t)(decoded.size() * sizeof(int16_t)),
+            .decoded_size = 0,
+        };
+        esp_audio_dec_info_t dec_info = {};
+        std::unique_lock<std::mutex> decoder_lock(decoder_mutex_);
+        auto ret = esp_opus_dec_decode(opus_decoder_, &raw, &out_frame, &dec_info);
+        decoder_lock.unlock();
+        if (ret == ESP_AUDIO_ERR_OK) {
+            decoded.resize(out_frame.decoded_size / sizeof(int16_t));
+            if (need_resample) {
+                uint32_t target_size = 0;
+                esp_ae_rate_cvt_get_max_out_sample_num(output_resampler_, decoded.size(), &target_size);
+                task->pcm.resize(target_size);
+                uint32_t actual_output = target_size;
+                esp_ae_rate_cvt_process(output_resampler_, (esp_ae_sample_t)decoded.data(), decoded.size(),
+                                        (esp_ae_sample_t)task->pcm.data(), &actual_output);
+                task->pcm.resize(actual_output);
             }
+            latency_tracer_.Record(kLatencyStageDecode, decode_start_us);
+            task->stage_time_us = LatencyTracer::Now();
+            audio_playback_queue_.Push(std::move(task));
+            NotifyTask(audio_output_task_handle_);
             debug_statistics_.decode_count++;
+            decoded_frame = true;
+        } else {
+            ESP_LOGE(TAG, "Failed to decode audio after resize, error code: %d", ret);
+        }
+    } else {
+        ESP_LOGE(TAG, "Audio decoder is not configured");
+    }
+    /* No-op if the frame was handed over to the playback queue */
+    playback_task_pool_.Release(std::move(task));
+    debug_statistics_.decode_count++;
+    return decoded_frame;
+}
+
+bool AudioService::DecodeSoundToEffectsQueue() {
+    if (audio_effects_queue_.full() ||
+        audio_effects_queue_.size() * SOUND_FRAME_DURATION_MS >= MAX_EFFECTS_QUEUE_DURATION_MS) {
+        return false;
+    }
+
+    if (cached_sound_ == nullptr) {
+        SoundFrame frame;
+        if (!audio_sound_queue_.Pop(frame)) {
+            return false;
+        }
+        if (frame.cached == nullptr) {
+            DecodeSoundFrame(frame);
+            packet_pool_.Release(std::move(frame.packet));
+            if (frame.last) {
+                CloseSoundDecoder();
+            }
+            return true;
+        }
+        cached_sound_ = std::move(frame.cached);
+        cached_sound_offset_ = 0;
+    }
+
+    /* A cached sound is already at the output rate, it is only cut into frames */
+    size_t frame_samples = codec_->output_sample_rate() / 1000 * SOUND_FRAME_DURATION_MS;
+    size_t count = std::min(frame_samples, cached_sound_->samples - cached_sound_offset_);
+    const int16_t* pcm = cached_sound_->pcm + cached_sound_offset_;
+    auto task = playback_task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToEffectsQueue;
+    task->timestamp = 0;
+    task->origin_time_us = 0;
+    task->stage_time_us = 0;
+    task->pcm.assign(pcm, pcm + count);
+    audio_effects_queue_.Push(std::move(task));
+    NotifyTask(audio_output_task_handle_);
+    playback_task_pool_.Release(std::move(task));
+
+    cached_sound_offset_ += count;
+    if (cached_sound_offset_ >= cached_sound_->samples) {
+        cached_sound_.reset();
+    }
+    return true;
+}
+
+void AudioService::DecodeSoundFrame(const SoundFrame& frame) {
+    if (frame.first) {
+        sound_cache_.BeginFill(frame.sound);
+    }
+    if (frame.payload == nullptr || !OpenSoundDecoder(frame.sample_rate, SOUND_FRAME_DURATION_MS)) {
+        sound_cache_.AbortFill();
+        return;
+    }
+
+    auto task = playback_task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToEffectsQueue;
+    task->timestamp = 0;
+    task->origin_time_us = 0;
+    task->stage_time_us = 0;
+
+    std::vector<int16_t>& decoded = sound_resampler_ != nullptr ? decode_buffer_ : task->pcm;
+    decoded.resize(sound_decoder_sample_rate_ / 1000 * sound_decoder_duration_ms_);
+    esp_audio_dec_in_raw_t raw = {
+        .buffer = const_cast<uint8_t*>(frame.payload),
+        .len = (uint32_t)(frame.payload_size),
+        .consumed = 0,
+        .frame_recover = ESP_AUDIO_DEC_RECOVERY_NONE,
+    };
+    esp_audio_dec_out_frame_t out_frame = {
+        .buffer = (uint8_t *)(decoded.data()),
+        .len = (uint32_t)(decoded.size() * sizeof(int16_t)),
+        .decoded_size = 0,
+    };
+    esp_audio_dec_info_t dec_info = {};
+    auto ret = esp_opus_dec_decode(sound_decoder_, &raw, &out_frame, &dec_info);
+    if (ret == ESP_AUDIO_ERR_OK) {
+        decoded.resize(out_frame.decoded_size / sizeof(int16_t));
+        if (sound_resampler_ != nullptr) {
+            uint32_t target_size = 0;
+            esp_ae_rate_cvt_get_max_out_sample_num(sound_resampler_, decoded.size(), &target_size);
+            task->pcm.resize(target_size);
+            uint32_t actual_output = target_size;
+            esp_ae_rate_cvt_process(sound_resampler_, (esp_ae_sample_t)decoded.data(), decoded.size(),
+                                    (esp_ae_sample_t)task->pcm.data(), &actual_output);
+            task->pcm.resize(actual_output);
+        }
+        /* Keep what was played, so the next time the sound skips the demuxer, the decoder and the resampler */
+        sound_cache_.AppendFill(task->pcm.data(), task->pcm.size());
+        if (frame.last) {
+            sound_cache_.CommitFill();
         }
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-
-            if (opus_encoder_ != nullptr && task->pcm.size() == encoder_frame_size_) {
-                std::vector<uint8_t> buf(encoder_outbuf_size_);
-                esp_audio_enc_in_frame_t in = {
-                    .buffer = (uint8_t *)(task->pcm.data()),
-                    .len = (uint32_t)(encoder_frame_size_ * sizeof(int16_t)),
-                };
-                esp_audio_enc_out_frame_t out = {
-                    .buffer = buf.data(),
-                    .len = (uint32_t)encoder_outbuf_size_,
-                    .encoded_bytes = 0,
-                };
-                auto ret = esp_opus_enc_process(opus_encoder_, &in, &out);
-                if (ret == ESP_AUDIO_ERR_OK) {
-                    packet->payload.assign(buf.data(), buf.data() + out.encoded_bytes);
-
-                    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                        {
-                            std::lock_guard<std::mutex> lock2(audio_queue_mutex_);
-                            audio_send_queue_.push_back(std::move(packet));
-                        }
-                        if (callbacks_.on_send_queue_available) {
-                            callbacks_.on_send_queue_available();
-                        }
-                    } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                        std::lock_guard<std::mutex> lock2(audio_queue_mutex_);
-                        audio_testing_queue_.push_back(std::move(packet));
+        audio_effects_queue_.Push(std::move(task));
+        NotifyTask(audio_output_task_handle_);
+    } else {
+        ESP_LOGE(TAG, "Failed to decode sound, error code: %d", ret);
+        sound_cache_.AbortFill();
+    }
+    playback_task_pool_.Release(std::move(task));
+}
+
+bool AudioService::OpenSoundDecoder(int sample_rate, int frame_duration) {
+    if (sound_decoder_ != nullptr && sound_decoder_sample_rate_ == sample_rate &&
+        sound_decoder_duration_ms_ == frame_duration) {
+        return true;
+    }
+    CloseSoundDecoder();
+
+    esp_opus_dec_cfg_t opus_dec_cfg = OPUS_DEC_CFG(sample_rate, frame_duration);
+    auto ret = esp_opus_dec_open(&opus_dec_cfg, sizeof(esp_opus_dec_cfg_t), &sound_decoder_);
+    if (sound_decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create sound decoder, error code: %d", ret);
+        return false;
+    }
+    sound_decoder_sample_rate_ = sample_rate;
+    sound_decoder_duration_ms_ = frame_duration;
+
+    if (sample_rate != codec_->output_sample_rate()) {
+        esp_ae_rate_cvt_cfg_t resampler_cfg = RATE_CVT_CFG(sample_rate, codec_->output_sample_rate(), ESP_AUDIO_MONO);
+        auto resampler_ret = esp_ae_rate_cvt_open(&resampler_cfg, &sound_resampler_);
+        if (sound_resampler_ == nullptr) {
+            ESP_LOGE(TAG, "Failed to create sound resampler, error code: %d", resampler_ret);
+        }
+    }
+    return true;
+}
+
+void AudioService::CloseSoundDecoder() {
+    if (sound_decoder_ != nullptr) {
+        esp_opus_dec_close(sound_decoder_);
+        sound_decoder_ = nullptr;
+    }
+    if (sound_resampler_ != nullptr) {
+        esp_ae_rate_cvt_close(sound_resampler_);
+        sound_resampler_ = nullptr;
+    }
+}
+
+void AudioService::OpusEncoderTask() {
+    auto release_encode_task = [this](std::unique_ptr<AudioTask>&& task) {
+        encode_task_pool_.Release(std::move(task));
+    };
+
+    while (!service_stopped_) {
+        if (audio_encode_queue_.Reclaim(release_encode_task) > 0) {
+            xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE);
+        }
+
+        /* Encode the audio to send queue, wait for the application if the send queue is full */
+        std::unique_ptr<AudioTask> task;
+        bool send_queue_full = audio_send_queue_.full() ||
+            audio_send_queue_.size() * encoder_duration_ms_ >= MAX_SEND_QUEUE_DURATION_MS;
+        if (send_queue_full || !audio_encode_queue_.Pop(task)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE);
+        latency_tracer_.Record(kLatencyStageEncodeQueue, task->stage_time_us);
+        int64_t encode_start_us = LatencyTracer::Now();
+
+        auto packet = packet_pool_.Acquire();
+        std::unique_lock<std::mutex> encoder_lock(encoder_mutex_);
+        packet->frame_duration = encoder_duration_ms_;
+        packet->sample_rate = 16000;
+        packet->timestamp = task->timestamp;
+        packet->origin_time_us = task->origin_time_us;
+
+        if (opus_encoder_ != nullptr && task->pcm.size() == (size_t)encoder_frame_size_) {
+            /* Encode in place, the payload capacity was reserved by the pool */
+            packet->payload.resize(encoder_outbuf_size_);
+            esp_audio_enc_in_frame_t in = {
+                .buffer = (uint8_t *)(task->pcm.data()),
+                .len = (uint32_t)(encoder_frame_size_ * sizeof(int16_t)),
+            };
+            esp_audio_enc_out_frame_t out = {
+                .buffer = packet->payload.data(),
+                .len = (uint32_t)encoder_outbuf_size_,
+                .encoded_bytes = 0,
+            };
+            int64_t process_start_us = LatencyTracer::Now();
+            auto ret = esp_opus_enc_process(opus_encoder_, &in, &out);
+            int64_t process_us = LatencyTracer::Now() - process_start_us;
+            encoder_lock.unlock();
+            if (ret == ESP_AUDIO_ERR_OK) {
+                packet->payload.resize(out.encoded_bytes);
+                latency_tracer_.Record(kLatencyStageEncode, encode_start_us);
+
+                /* A new complexity is applied by EnableVoiceProcessing() at the next turn */
+                complexity_governor_.Update(process_us, encoder_duration_ms_, audio_encode_queue_.size());
+                packet->stage_time_us = LatencyTracer::Now();
+
+                if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+                    audio_send_queue_.Push(std::move(packet));
+                    if (callbacks_.on_send_queue_available) {
+                        callbacks_.on_send_queue_available();
+                    }
+                } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+                    /* The recording is replayed through the decode queue, whose packets go back to the
+                     * receive pool. Testing is a debug feature, so it takes a heap copy and the pooled
+                     * packet stays with packet_pool_ */
+                    auto testing_packet = std::make_unique<AudioStreamPacket>();
+                    testing_packet->sample_rate = packet->sample_rate;
+                    testing_packet->frame_duration = packet->frame_duration;
+                    testing_packet->timestamp = packet->timestamp;
+                    testing_packet->payload.assign(packet->payload.data(), packet->payload.data() + packet->payload.size());
+                    if (!audio_testing_queue_.Push(std::move(testing_packet))) {
+                        ESP_LOGW(TAG, "Audio testing queue is full, dropping packet");
                     }
-                    debug_statistics_.encode_count++;
-                } else {
-                    ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
                 }
+                debug_statistics_.encode_count++;
             } else {
-                ESP_LOGE(TAG, "Failed to encode audio: encoder not configured or invalid frame size (got %u, expected %u)",
-                         task->pcm.size(), encoder_frame_size_);
+                ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
             }
-            lock.lock();
+        } else {
+            /* Frames captured before a frame duration switch are dropped */
+            ESP_LOGE(TAG, "Failed to encode audio: encoder not configured or invalid frame size (got %zu, expected %d)",
+                     task->pcm.size(), encoder_frame_size_);
+            encoder_lock.unlock();
         }
+        packet_pool_.Release(std::move(packet));
+        encode_task_pool_.Release(std::move(task));
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    audio_encode_queue_.Reclaim(release_encode_task);
+    ESP_LOGW(TAG, "Opus encoder task stopped");
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -481,53 +939,95 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     }
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, const int16_t* pcm, size_t samples) {
+    auto task = encode_task_pool_.Acquire();
     task->type = type;
-    task->pcm = std::move(pcm);
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
-        }
-        timestamp_queue_.pop_front();
+    task->timestamp = 0;
+    task->pcm.assign(pcm, pcm + samples);
+    task->origin_time_us = 0;
+    task->stage_time_us = LatencyTracer::Now();
+    if (type == kAudioTaskTypeEncodeToSendQueue) {
+        task->origin_time_us = last_capture_time_us_;
+        latency_tracer_.Record(kLatencyStageProcessor, task->origin_time_us);
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+#if CONFIG_USE_SERVER_AEC
+    /* Stamp the frame with the downlink audio that was playing when its first sample was captured */
+    if (type == kAudioTaskTypeEncodeToSendQueue) {
+        int64_t frame_us = (int64_t)task->pcm.size() * 1000000 / encoder_sample_rate_;
+        task->timestamp = playback_clock_.TimestampAt(task->origin_time_us - frame_us);
+    }
+#endif
+
+    /* Push the task to the encode queue, wait for the encoder if the queue is full */
+    while (!service_stopped_) {
+        xEventGroupClearBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE);
+        {
+            std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+            if (audio_encode_queue_.size() * encoder_duration_ms_ < MAX_ENCODE_QUEUE_DURATION_MS &&
+                audio_encode_queue_.Push(std::move(task))) {
+                break;
+            }
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    NotifyTask(opus_encoder_task_handle_);
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    packet->stage_time_us = LatencyTracer::Now();
+    int64_t speech_end_us = turn_speech_end_us_.exchange(0);
+    if (speech_end_us != 0) {
+        debug_statistics_.speech_end_to_response_ms = (packet->stage_time_us - speech_end_us) / 1000;
+    }
+    while (true) {
+        xEventGroupClearBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            int frame_duration = std::max(packet->frame_duration, OPUS_MIN_FRAME_DURATION_MS);
+            if (audio_decode_queue_.size() * frame_duration < MAX_DECODE_QUEUE_DURATION_MS &&
+                audio_decode_queue_.Push(std::move(packet))) {
+                break;
+            }
+        }
+        if (!wait || service_stopped_) {
+            receive_packet_pool_.Release(std::move(packet));
             return false;
         }
+        xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE, pdFALSE, pdFALSE, portMAX_DELAY);
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    NotifyTask(opus_decoder_task_handle_);
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+    std::unique_ptr<AudioStreamPacket> packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    NotifyTask(opus_encoder_task_handle_);
+    latency_tracer_.Record(kLatencyStageSendQueue, packet->stage_time_us);
+    packet->stage_time_us = LatencyTracer::Now();
     return packet;
 }
 
+std::unique_ptr<AudioStreamPacket> AudioService::AcquireReceivePacket() {
+    return receive_packet_pool_.Acquire();
+}
+
+void AudioService::ReleaseReceivePacket(std::unique_ptr<AudioStreamPacket> packet) {
+    receive_packet_pool_.Release(std::move(packet));
+}
+
+void AudioService::ReleasePacket(std::unique_ptr<AudioStreamPacket> packet) {
+    packet_pool_.Release(std::move(packet));
+}
+
+void AudioService::RecordPacketSent(const AudioStreamPacket& packet) {
+    latency_tracer_.Record(kLatencyStageSend, packet.stage_time_us);
+    latency_tracer_.Record(kLatencyStageUplink, packet.origin_time_us);
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -539,11 +1039,20 @@ const std::string& AudioService::GetLastWakeWord() const {
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
-    if (wake_word_->GetWakeWordOpus(packet->payload)) {
-        return packet;
+    std::vector<uint8_t> opus;
+    if (!wake_word_->GetWakeWordOpus(opus)) {
+        return nullptr;
     }
-    return nullptr;
+    /* The packet comes from the pool, nothing of its last use may reach the AEC, the batcher or the tracer */
+    auto packet = packet_pool_.Acquire();
+    packet->sample_rate = 16000;
+    packet->frame_duration = OPUS_FRAME_DURATION_MS;
+    packet->timestamp = 0;
+    packet->sequence = 0;
+    packet->origin_time_us = 0;
+    packet->stage_time_us = 0;
+    packet->payload.assign(opus.data(), opus.data() + opus.size());
+    return packet;
 }
 
 void AudioService::EnableWakeWordDetection(bool enable) {
@@ -567,6 +1076,9 @@ void AudioService::EnableWakeWordDetection(bool enable) {
             if (input_resampler_ != nullptr) {
                 esp_ae_rate_cvt_reset(input_resampler_);
             }
+            if (input_mono_resampler_ != nullptr) {
+                esp_ae_rate_cvt_reset(input_mono_resampler_);
+            }
         }
         wake_word_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_WAKE_WORD_RUNNING);
@@ -580,13 +1092,12 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, encoder_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
-        audio_input_need_warmup_ = true;
         // Reset input resampler to clear cached data from previous mode (e.g. WakeWord)
         // This prevents buffer overflow when switching between different feed sizes
         {
@@ -594,7 +1105,15 @@ void AudioService::EnableVoiceProcessing(bool enable) {
             if (input_resampler_ != nullptr) {
                 esp_ae_rate_cvt_reset(input_resampler_);
             }
+            if (input_mono_resampler_ != nullptr) {
+                esp_ae_rate_cvt_reset(input_mono_resampler_);
+            }
         }
+        /* Reopening the encoder resets its state, so a complexity step waits for the start of a turn */
+        if (complexity_governor_.complexity() != complexity_governor_.applied()) {
+            OpenEncoder(encoder_duration_ms_, complexity_governor_.complexity());
+        }
+        endpointer_reset_ = true;
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
@@ -603,83 +1122,325 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     }
 }
 
+void AudioService::EnableEndpointer(bool enable) {
+    endpointer_enabled_ = enable;
+}
+
+bool AudioService::EndpointUplinkFrame(size_t samples) {
+    if (endpointer_reset_.exchange(false)) {
+        endpointer_.Reset();
+        uplink_ended_ = false;
+        turn_speech_end_us_ = 0;
+        debug_statistics_.trailing_uplink_ms = 0;
+    }
+    int frame_ms = samples / 16;
+    if (uplink_ended_) {
+        debug_statistics_.endpoint_dropped_ms += frame_ms;
+        return false;
+    }
+
+    /* Runs in every mode, so the statistics compare with the server ending the turn */
+    int64_t now_us = esp_timer_get_time();
+    auto event = endpointer_.Process(voice_detected_, now_us);
+    int64_t speech_end_us = endpointer_.speech_end_us();
+    turn_speech_end_us_ = speech_end_us;
+    if (speech_end_us != 0) {
+        debug_statistics_.trailing_uplink_ms += frame_ms;
+    }
+    if (event == kEndpointerEventNone || !endpointer_enabled_) {
+        return true;
+    }
+
+    uplink_ended_ = true;
+    if (speech_end_us == 0) {
+        turn_speech_end_us_ = now_us;
+    }
+    debug_statistics_.endpoint_count++;
+    if (event == kEndpointerEventMaxUtterance) {
+        debug_statistics_.endpoint_max_utterance_count++;
+    }
+    debug_statistics_.endpoint_dropped_ms += frame_ms;
+    if (callbacks_.on_end_of_speech) {
+        callbacks_.on_end_of_speech();
+    }
+    return false;
+}
+
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
     if (enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_ */
+        std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+        audio_decode_queue_.Flush();
+        std::unique_ptr<AudioStreamPacket> packet;
+        while (audio_testing_queue_.Pop(packet)) {
+            if (!audio_decode_queue_.Push(std::move(packet))) {
+                ESP_LOGW(TAG, "Audio decode queue is full, dropping testing packets");
+                audio_testing_queue_.Flush();
+                break;
+            }
+        }
+        NotifyTask(opus_decoder_task_handle_);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, encoder_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
 }
 
+void AudioService::EnableDecoderFec(bool enable) {
+    ESP_LOGI(TAG, "%s decoder FEC", enable ? "Enabling" : "Disabling");
+    decoder_fec_enabled_ = enable;
+}
+
+void AudioService::SetEncodeFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration %d ms, keeping %d ms", frame_duration_ms, encoder_duration_ms_.load());
+        return;
+    }
+    if (frame_duration_ms == encoder_duration_ms_) {
+        return;
+    }
+    ESP_LOGI(TAG, "Switching uplink frame duration from %d ms to %d ms", encoder_duration_ms_.load(), frame_duration_ms);
+    OpenEncoder(frame_duration_ms, complexity_governor_.complexity());
+    audio_processor_->SetFrameDuration(frame_duration_ms);
+}
+
+bool AudioService::OpenEncoder(int frame_duration_ms, int complexity) {
+    std::lock_guard<std::mutex> encoder_lock(encoder_mutex_);
+    if (opus_encoder_ != nullptr) {
+        esp_opus_enc_close(opus_encoder_);
+        opus_encoder_ = nullptr;
+    }
+    esp_opus_enc_config_t opus_enc_cfg = AS_OPUS_ENC_CONFIG(frame_duration_ms);
+    opus_enc_cfg.complexity = complexity;
+    auto ret = esp_opus_enc_open(&opus_enc_cfg, sizeof(esp_opus_enc_config_t), &opus_encoder_);
+    if (opus_encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", ret);
+        return false;
+    }
+    encoder_duration_ms_ = frame_duration_ms;
+    complexity_governor_.SetApplied(complexity);
+    esp_opus_enc_get_frame_size(opus_encoder_, &encoder_frame_size_, &encoder_outbuf_size_);
+    encoder_frame_size_ = encoder_frame_size_ / sizeof(int16_t);
+    return true;
+}
+
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
 
 void AudioService::PlaySound(const std::string_view& ogg) {
-    if (!codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableOutput(true);
-    }
-
+    /* The output task powers the output up for the first chunk, the caller does not wait for it */
     const auto* buf = reinterpret_cast<const uint8_t*>(ogg.data());
     size_t size = ogg.size();
 
+    /* Never wait for room, a sound that does not fit is cut rather than blocking the caller */
+    std::lock_guard<std::mutex> lock(sound_producer_mutex_);
+    auto queue_full = [this]() {
+        return audio_sound_queue_.full() ||
+            audio_sound_queue_.size() * SOUND_FRAME_DURATION_MS >= MAX_SOUND_QUEUE_DURATION_MS;
+    };
+
+    auto cached = sound_cache_.Find(ogg.data());
+    if (cached != nullptr) {
+        SoundFrame frame;
+        frame.sound = ogg.data();
+        frame.cached = std::move(cached);
+        if (queue_full() || !audio_sound_queue_.Push(std::move(frame))) {
+            ESP_LOGW(TAG, "Sound queue is full, the sound is dropped");
+            return;
+        }
+        NotifyTask(opus_decoder_task_handle_);
+        return;
+    }
+
+    /* Each packet is queued once the next one is demuxed, so the last one can be marked for the cache.
+       Packets are queued in place in the Ogg data, only those the demuxer had to reassemble are copied */
+    SoundFrame pending;
+    bool first = true;
+    bool dropped = false;
+    auto push_pending = [&](bool last) {
+        pending.last = last;
+        if (queue_full() || !audio_sound_queue_.Push(std::move(pending))) {
+            packet_pool_.Release(std::move(pending.packet));
+            dropped = true;
+        } else {
+            NotifyTask(opus_decoder_task_handle_);
+        }
+        pending = SoundFrame();
+    };
+
     auto demuxer = std::make_unique<OggDemuxer>();
-    demuxer->OnDemuxerFinished([this](const uint8_t* data, int sample_rate, size_t size){
-        auto packet = std::make_unique<AudioStreamPacket>();
-        packet->sample_rate = sample_rate;
-        packet->frame_duration = 60;
-        packet->payload.resize(size);
-        std::memcpy(packet->payload.data(), data, size);
-        PushPacketToDecodeQueue(std::move(packet), true);
+    demuxer->OnDemuxerFinished([&](const uint8_t* data, int sample_rate, size_t size){
+        if (dropped) {
+            return;
+        }
+        if (pending.payload != nullptr) {
+            push_pending(false);
+            if (dropped) {
+                return;
+            }
+        }
+        pending.sound = ogg.data();
+        pending.sample_rate = sample_rate;
+        pending.first = first;
+        first = false;
+        if (data >= buf && data + size <= buf + ogg.size()) {
+            pending.payload = data;
+        } else {
+            pending.packet = packet_pool_.Acquire();
+            auto& packet = pending.packet;
+            packet->sample_rate = sample_rate;
+            packet->frame_duration = SOUND_FRAME_DURATION_MS;
+            packet->timestamp = 0;
+            packet->sequence = 0;
+            packet->origin_time_us = 0;
+            packet->payload.assign(data, data + size);
+            pending.payload = packet->payload.data();
+        }
+        pending.payload_size = size;
     });
+    demuxer->EnableZeroCopy(true);
     demuxer->Reset();
     demuxer->Process(buf, size);
+    if (pending.payload != nullptr && !dropped) {
+        push_pending(true);
+    }
+    if (dropped) {
+        ESP_LOGW(TAG, "Sound queue is full, the rest of the sound is dropped");
+    }
+}
+
+DebugStatistics AudioService::GetDebugStatistics() {
+    DebugStatistics statistics = debug_statistics_;
+    statistics.encode_task_pool_exhausted = encode_task_pool_.exhausted_count();
+    statistics.playback_task_pool_exhausted = playback_task_pool_.exhausted_count();
+    statistics.packet_pool_exhausted = packet_pool_.exhausted_count();
+    statistics.receive_packet_pool_exhausted = receive_packet_pool_.exhausted_count();
+    auto jitter = jitter_buffer_.statistics();
+    statistics.jitter_target_delay_ms = jitter.target_delay_ms;
+    statistics.jitter_underrun_count = jitter.underruns;
+    statistics.jitter_late_packet_count = jitter.late_packets;
+    statistics.concealed_count = jitter.concealed;
+    statistics.encoder_complexity = complexity_governor_.applied();
+    statistics.encoder_load_percent = complexity_governor_.load_percent();
+    statistics.complexity_step_up_count = complexity_governor_.step_ups();
+    statistics.complexity_step_down_count = complexity_governor_.step_downs();
+    statistics.sound_cache_hit_count = sound_cache_.hits();
+    statistics.sound_cache_miss_count = sound_cache_.misses();
+    statistics.sound_cache_bytes = sound_cache_.used_bytes();
+    statistics.endpoint_short_speech_count = endpointer_.short_speech_count();
+    statistics.encode_queue_depth = audio_encode_queue_.size();
+    statistics.send_queue_depth = audio_send_queue_.size();
+    statistics.decode_queue_depth = audio_decode_queue_.size() + jitter_buffer_.size();
+    statistics.playback_queue_depth = audio_playback_queue_.size();
+    statistics.effects_queue_depth = audio_effects_queue_.size();
+    return statistics;
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.empty() && IsPlaybackDrained() && audio_testing_queue_.empty();
+}
+
+bool AudioService::IsPlaybackDrained() const {
+    return audio_decode_queue_.empty() && jitter_buffer_.empty() && audio_playback_queue_.empty() &&
+        audio_sound_queue_.empty() && audio_effects_queue_.empty();
 }
 
 void AudioService::WaitForPlaybackQueueEmpty() {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    audio_queue_cv_.wait(lock, [this]() { 
-        return service_stopped_ || (audio_decode_queue_.empty() && audio_playback_queue_.empty()); 
-    });
+    while (!service_stopped_) {
+        xEventGroupClearBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+        if (IsPlaybackDrained()) {
+            break;
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     std::unique_lock<std::mutex> decoder_lock(decoder_mutex_);
     if (opus_decoder_ != nullptr) {
         esp_opus_dec_reset(opus_decoder_);
     }
     decoder_lock.unlock();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    playback_abort_time_us_ = esp_timer_get_time();
+    playback_abort_generation_++;
+    audio_decode_queue_.Flush();
+    jitter_reset_generation_++;
+    audio_playback_queue_.Flush();
+    audio_testing_queue_.Flush();
+    xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_QUEUE_EMPTY);
+    NotifyTask(opus_decoder_task_handle_);
+    NotifyTask(audio_output_task_handle_);
+}
+
+void AudioService::PowerUpInput() {
+    if (!codec_->input_enabled()) {
+        EnsureInputPowered(true);
+    }
+}
+
+void AudioService::PowerUpOutput() {
+    if (!codec_->output_enabled()) {
+        EnsureOutputPowered(true);
+    }
+}
+
+void AudioService::EnsureInputPowered(bool predicted) {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    if (codec_->input_enabled()) {
+        return;
+    }
+    /* Count the power-up as activity, so the timer does not take it back before the input is used */
+    last_input_time_ = std::chrono::steady_clock::now();
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+    codec_->EnableInput(true);
+    /* The first read measures the warm-up, once the codec reports settled samples */
+    debug_statistics_.input_power_up_count++;
+    debug_statistics_.input_warmup_ms = 0;
+    debug_statistics_.input_warmup_wait_ms = 0;
+    if (predicted) {
+        debug_statistics_.input_power_up_predicted_count++;
+    }
+    ESP_LOGI(TAG, "Input powered up%s", predicted ? " ahead of use" : "");
+}
+
+void AudioService::EnsureOutputPowered(bool predicted) {
+    std::lock_guard<std::mutex> lock(power_mutex_);
+    if (codec_->output_enabled()) {
+        return;
+    }
+    last_output_time_ = std::chrono::steady_clock::now();
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+    int64_t start_us = esp_timer_get_time();
+    codec_->EnableOutput(true);
+    uint32_t warmup_ms = (esp_timer_get_time() - start_us) / 1000;
+    debug_statistics_.output_power_up_count++;
+    debug_statistics_.output_warmup_ms = warmup_ms;
+    /* A predicted power-up is off the playback path, the first frame does not wait for it */
+    if (predicted) {
+        debug_statistics_.output_power_up_predicted_count++;
+        debug_statistics_.output_warmup_wait_ms = 0;
+    } else {
+        debug_statistics_.output_warmup_wait_ms = warmup_ms;
+    }
+    ESP_LOGI(TAG, "Output powered up%s in %" PRIu32 " ms", predicted ? " ahead of use" : "", warmup_ms);
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
+    std::lock_guard<std::mutex> lock(power_mutex_);
     auto now = std::chrono::steady_clock::now();
     auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
     auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
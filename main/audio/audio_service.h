@@ -2,10 +2,9 @@
 #define AUDIO_SERVICE_H
 
 #include <memory>
-#include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -24,25 +23,90 @@
 #include "wake_word.h"
 #include "protocol.h"
 #include "ogg_demuxer.h"
+#include "spsc_queue.h"
+#include "object_pool.h"
+#include "jitter_buffer.h"
+#include "latency_tracer.h"
+#include "complexity_governor.h"
+#include "endpointer.h"
+#include "playback_clock.h"
+#include "audio_mixer.h"
+#include "sound_cache.h"
 
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> {Jitter Buffer} -> [Opus Decoder] -> {Playback Queue} -> [Mixer] -> (Speaker)
+ *    (PlaySound) -> {Sound Queue} -> [Opus Decoder] -> {Effects Queue} -----------------^
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Processors, one for Speaker, and separate tasks for Opus Encoder and Opus Decoder.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
+ * Every queue is a bounded SPSC ring. The consumer task of each edge is woken by a task notification
+ * from its producer, and producers that block on a full queue wait for the edge's own event bit.
+ * 
  */
 
-#define OPUS_FRAME_DURATION_MS 60
-#define MAX_ENCODE_TASKS_IN_QUEUE 2
-#define MAX_PLAYBACK_TASKS_IN_QUEUE 2
-#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+/* Preferred uplink frame duration, the session uses the one negotiated in the hello exchange */
+#define OPUS_FRAME_DURATION_MS CONFIG_AUDIO_OPUS_FRAME_DURATION_MS
+#define OPUS_MIN_FRAME_DURATION_MS 20
+#define OPUS_MAX_FRAME_DURATION_MS 60
+
+/* Queue limits are in milliseconds of audio, the rings have enough slots for the shortest frames */
+#define MAX_ENCODE_QUEUE_DURATION_MS 120
+#define MAX_PLAYBACK_QUEUE_DURATION_MS 120
+#define MAX_DECODE_QUEUE_DURATION_MS 2400
+#define MAX_SEND_QUEUE_DURATION_MS 2400
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
+/* PlaySound() never blocks, the part of a sound that does not fit is dropped. Long enough for the
+ * activation prompt followed by the code digits. */
+#define MAX_SOUND_QUEUE_DURATION_MS 15000
+#define SOUND_FRAME_DURATION_MS 60
+#define MAX_EFFECTS_QUEUE_DURATION_MS 120
+#define MAX_ENCODE_TASKS_IN_QUEUE (MAX_ENCODE_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_PLAYBACK_TASKS_IN_QUEUE (MAX_PLAYBACK_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_DECODE_PACKETS_IN_QUEUE (MAX_DECODE_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (MAX_SEND_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define AUDIO_TESTING_MAX_PACKETS (AUDIO_TESTING_MAX_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_SOUND_PACKETS_IN_QUEUE (MAX_SOUND_QUEUE_DURATION_MS / SOUND_FRAME_DURATION_MS)
+#define MAX_EFFECTS_TASKS_IN_QUEUE (MAX_EFFECTS_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define JITTER_BUFFER_CAPACITY (MAX_DECODE_PACKETS_IN_QUEUE / 2)
+#define JITTER_BUFFER_MAX_DELAY_MS 600
+
+/* Preallocated frames, enough for a full queue plus the frames held by the tasks on both ends.
+ * Frames are reserved for the shortest duration and grow once if longer frames are used. */
+#define ENCODE_TASK_POOL_SIZE (MAX_ENCODE_TASKS_IN_QUEUE + 2)
+#define PLAYBACK_TASK_POOL_SIZE (MAX_PLAYBACK_TASKS_IN_QUEUE + MAX_EFFECTS_TASKS_IN_QUEUE + 3)
+/* Uplink packets, enough for a full send queue of the shortest frames plus the packets held by the
+ * encoder and the sender. The wake word pre-roll and sound packets that span two Ogg pages come on
+ * top of that, and only fall back to the heap while the send queue is full. */
+#define AUDIO_PACKET_POOL_SIZE (MAX_SEND_PACKETS_IN_QUEUE + 2)
+/* Downlink packets, shared by the protocol and the decoder. Enough for a full decode queue of the
+ * shortest frames plus the packets held by the receiving and decoding tasks. */
+#define RECEIVE_PACKET_POOL_SIZE (MAX_DECODE_PACKETS_IN_QUEUE + 2)
+
+/* Opus encoder complexity range, fixed to the minimum without the governor */
+#define OPUS_COMPLEXITY_MIN CONFIG_AUDIO_OPUS_COMPLEXITY_MIN
+#if CONFIG_AUDIO_OPUS_COMPLEXITY_GOVERNOR
+#define OPUS_COMPLEXITY_MAX CONFIG_AUDIO_OPUS_COMPLEXITY_MAX
+#else
+#define OPUS_COMPLEXITY_MAX CONFIG_AUDIO_OPUS_COMPLEXITY_MIN
+#endif
+
+/* On-device end of the turn in auto-stop mode. Without it the endpointer still runs, for the statistics only */
+#if CONFIG_AUDIO_ENDPOINTER
+#define ENDPOINTER_HANGOVER_MS CONFIG_AUDIO_ENDPOINTER_HANGOVER_MS
+#define ENDPOINTER_MIN_SPEECH_MS CONFIG_AUDIO_ENDPOINTER_MIN_SPEECH_MS
+#define ENDPOINTER_MAX_UTTERANCE_MS CONFIG_AUDIO_ENDPOINTER_MAX_UTTERANCE_MS
+#else
+#define ENDPOINTER_HANGOVER_MS 800
+#define ENDPOINTER_MIN_SPEECH_MS 240
+#define ENDPOINTER_MAX_UTTERANCE_MS 20000
+#endif
+
+/* The output task writes frames in chunks of this length and checks for an abort in between */
+#define PLAYBACK_CHUNK_DURATION_MS 10
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
@@ -51,6 +115,13 @@
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
+#define AS_EVENT_ENCODE_QUEUE_AVAILABLE     (1 << 4)
+#define AS_EVENT_DECODE_QUEUE_AVAILABLE     (1 << 5)
+#define AS_EVENT_PLAYBACK_QUEUE_EMPTY       (1 << 6)
+#define AS_EVENT_ENCODER_TASK_STOPPED       (1 << 7)
+#define AS_EVENT_DECODER_TASK_STOPPED       (1 << 8)
+
+#define AUDIO_CODEC_TASK_STOP_TIMEOUT_MS 1000
 
 #define AS_OPUS_GET_FRAME_DRU_ENUM(duration_ms)                   \
     ((duration_ms) == 5 ? ESP_OPUS_ENC_FRAME_DURATION_5_MS :      \
@@ -62,23 +133,24 @@
      (duration_ms) == 100 ? ESP_OPUS_ENC_FRAME_DURATION_100_MS :  \
      (duration_ms) == 120 ? ESP_OPUS_ENC_FRAME_DURATION_120_MS : -1)
 
-#define AS_OPUS_ENC_CONFIG() {                                                                                    \
-        .sample_rate        = ESP_AUDIO_SAMPLE_RATE_16K,                                                          \
-        .channel            = ESP_AUDIO_MONO,                                                                     \
-        .bits_per_sample    = ESP_AUDIO_BIT16,                                                                    \
-        .bitrate            = ESP_OPUS_BITRATE_AUTO,                                                              \
-        .frame_duration     = (esp_opus_enc_frame_duration_t)AS_OPUS_GET_FRAME_DRU_ENUM(OPUS_FRAME_DURATION_MS),  \
-        .application_mode   = ESP_OPUS_ENC_APPLICATION_AUDIO,                                                     \
-        .complexity         = 0,                                                                                  \
-        .enable_fec         = false,                                                                              \
-        .enable_dtx         = true,                                                                               \
-        .enable_vbr         = true,                                                                               \
+#define AS_OPUS_ENC_CONFIG(duration_ms) {                                                                 \
+        .sample_rate        = ESP_AUDIO_SAMPLE_RATE_16K,                                                  \
+        .channel            = ESP_AUDIO_MONO,                                                             \
+        .bits_per_sample    = ESP_AUDIO_BIT16,                                                            \
+        .bitrate            = ESP_OPUS_BITRATE_AUTO,                                                      \
+        .frame_duration     = (esp_opus_enc_frame_duration_t)AS_OPUS_GET_FRAME_DRU_ENUM(duration_ms),     \
+        .application_mode   = ESP_OPUS_ENC_APPLICATION_AUDIO,                                             \
+        .complexity         = 0,                                                                          \
+        .enable_fec         = false,                                                                      \
+        .enable_dtx         = true,                                                                       \
+        .enable_vbr         = true,                                                                       \
     }
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
+    std::function<void(void)> on_end_of_speech;
     std::function<void(void)> on_audio_testing_queue_full;
 };
 
@@ -87,12 +159,28 @@ enum AudioTaskType {
     kAudioTaskTypeEncodeToSendQueue,
     kAudioTaskTypeEncodeToTestingQueue,
     kAudioTaskTypeDecodeToPlaybackQueue,
+    kAudioTaskTypeDecodeToEffectsQueue,
 };
 
 struct AudioTask {
     AudioTaskType type;
     std::vector<int16_t> pcm;
     uint32_t timestamp;
+    int64_t origin_time_us = 0;
+    int64_t stage_time_us = 0;
+};
+
+/* An item of the sound queue, one Opus packet of a sound or a whole sound taken from the cache */
+struct SoundFrame {
+    const void* sound = nullptr;  // Address of the Ogg data, the cache key
+    int sample_rate = 0;
+    // The Opus packet, in place in the Ogg data, or copied into `packet` when it spans two Ogg pages
+    const uint8_t* payload = nullptr;
+    size_t payload_size = 0;
+    std::unique_ptr<AudioStreamPacket> packet;
+    std::shared_ptr<const SoundCache::Entry> cached;
+    bool first = false;
+    bool last = false;
 };
 
 struct DebugStatistics {
@@ -100,6 +188,54 @@ struct DebugStatistics {
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    // Number of times a pool was empty and a frame had to be allocated from the heap
+    uint32_t encode_task_pool_exhausted = 0;
+    uint32_t playback_task_pool_exhausted = 0;
+    uint32_t packet_pool_exhausted = 0;
+    uint32_t receive_packet_pool_exhausted = 0;
+    // Downlink jitter buffer
+    uint32_t jitter_target_delay_ms = 0;
+    uint32_t jitter_underrun_count = 0;
+    uint32_t jitter_late_packet_count = 0;
+    uint32_t concealed_count = 0;
+    // Concealed frames that were played, rebuilt from the FEC of the next packet or extrapolated by PLC
+    uint32_t fec_recovered_count = 0;
+    uint32_t plc_count = 0;
+    // Opus encoder complexity governor
+    int encoder_complexity = 0;
+    uint32_t encoder_load_percent = 0;
+    uint32_t complexity_step_up_count = 0;
+    uint32_t complexity_step_down_count = 0;
+    // Barge-in, from ResetDecoder() to the output being silenced
+    uint32_t playback_abort_count = 0;
+    uint32_t abort_to_silence_us = 0;
+    uint32_t max_abort_to_silence_us = 0;
+    // Decoded system sounds
+    uint32_t sound_cache_hit_count = 0;
+    uint32_t sound_cache_miss_count = 0;
+    uint32_t sound_cache_bytes = 0;
+    // Auto-stop turns, compare with the endpointer on and off
+    uint32_t endpoint_count = 0;                // Turns ended on the device
+    uint32_t endpoint_max_utterance_count = 0;  // ... of which cut at the maximum length
+    uint32_t endpoint_short_speech_count = 0;   // Bursts too short to count as speech
+    uint32_t endpoint_dropped_ms = 0;           // Uplink audio not sent after the device ended the turn
+    uint32_t trailing_uplink_ms = 0;            // Uplink audio sent after the end of speech, last turn
+    uint32_t speech_end_to_response_ms = 0;     // End of speech to the first reply packet, last turn
+    // Codec power-ups, predicted ones happen before the audio is needed
+    uint32_t input_power_up_count = 0;
+    uint32_t input_power_up_predicted_count = 0;
+    uint32_t input_warmup_ms = 0;               // Power-up to the first settled read, last power-up
+    uint32_t input_warmup_wait_ms = 0;          // How long the first read waited for it
+    uint32_t output_power_up_count = 0;
+    uint32_t output_power_up_predicted_count = 0;
+    uint32_t output_warmup_ms = 0;              // Time to open the output, last power-up
+    uint32_t output_warmup_wait_ms = 0;         // How long the output task waited for it
+    // Frames waiting in each queue when the statistics were taken
+    uint32_t encode_queue_depth = 0;
+    uint32_t send_queue_depth = 0;
+    uint32_t decode_queue_depth = 0;            // Including the jitter buffer
+    uint32_t playback_queue_depth = 0;
+    uint32_t effects_queue_depth = 0;
 };
 
 class AudioService {
@@ -122,17 +258,39 @@ public:
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
+    /// @brief End the turn on the device once the user stops speaking, takes effect at the next EnableVoiceProcessing(true)
+    void EnableEndpointer(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    void EnableDecoderFec(bool enable);
+    /// @brief Power the input up ahead of a turn, so it has settled by the time it is read
+    void PowerUpInput();
+    /// @brief Power the output up ahead of a reply, so the first frame does not wait for the codec
+    void PowerUpOutput();
+    /// @brief Switch the uplink to 20, 40 or 60 ms frames, the processor output follows
+    void SetEncodeFrameDuration(int frame_duration_ms);
+    int encode_frame_duration() const { return encoder_duration_ms_; }
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    /// @brief A downlink packet for the protocol to receive into, it returns to the pool once decoded
+    std::unique_ptr<AudioStreamPacket> AcquireReceivePacket();
+    /// @brief Return a downlink packet that was not pushed to the decode queue
+    void ReleaseReceivePacket(std::unique_ptr<AudioStreamPacket> packet);
+    void ReleasePacket(std::unique_ptr<AudioStreamPacket> packet);
+    /// @brief Called by the sender once a packet popped from the send queue went out
+    void RecordPacketSent(const AudioStreamPacket& packet);
+    /// @brief The sound must stay in place until it has played, e.g. an asset embedded in the firmware
     void PlaySound(const std::string_view& sound);
-    bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
+    /// @brief Read from the codec, resample to `sample_rate` and keep `channels` channels (0 for all, 1 for the left one)
+    bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples, int channels = 0);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    DebugStatistics GetDebugStatistics();
+    LatencyTracer& GetLatencyTracer() { return latency_tracer_; }
+    AudioMixer& GetAudioMixer() { return audio_mixer_; }
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -143,19 +301,65 @@ private:
     void* opus_encoder_ = nullptr;
     void* opus_decoder_ = nullptr;
     std::mutex decoder_mutex_;
+    std::mutex encoder_mutex_;
     std::mutex input_resampler_mutex_;
     esp_ae_rate_cvt_handle_t input_resampler_ = nullptr;
+    esp_ae_rate_cvt_handle_t input_mono_resampler_ = nullptr;
+    // Owned by the reader, raw codec samples before they are resampled into the caller's buffer
+    std::vector<int16_t> capture_buffer_;
     esp_ae_rate_cvt_handle_t output_resampler_ = nullptr;
     
     // Encoder/Decoder state
     int encoder_sample_rate_ = 16000;
-    int encoder_duration_ms_ = OPUS_FRAME_DURATION_MS;
+    std::atomic<int> encoder_duration_ms_{OPUS_FRAME_DURATION_MS};
     int encoder_frame_size_ = 0;
     int encoder_outbuf_size_ = 0;
     int decoder_sample_rate_ = 0;
-    int decoder_duration_ms_ = OPUS_FRAME_DURATION_MS;
+    int decoder_duration_ms_ = OPUS_MAX_FRAME_DURATION_MS;
     int decoder_frame_size_ = 0;
     DebugStatistics debug_statistics_;
+    ObjectPool<AudioTask> encode_task_pool_;
+    ObjectPool<AudioTask> playback_task_pool_;
+    ObjectPool<AudioStreamPacket> packet_pool_;
+    ObjectPool<AudioStreamPacket> receive_packet_pool_;
+    // Owned by the decoder task, decoded PCM before it is resampled into a playback task
+    std::vector<int16_t> decode_buffer_;
+    // Owned by the decoder task, ResetDecoder() bumps the generation to have it cleared
+    JitterBuffer jitter_buffer_{JITTER_BUFFER_CAPACITY, JITTER_BUFFER_MAX_DELAY_MS};
+    std::atomic<uint32_t> jitter_reset_generation_{0};
+    std::atomic<bool> decoder_fec_enabled_{false};
+    // ResetDecoder() bumps the generation, the output task stops between chunks and flushes the codec
+    std::atomic<uint32_t> playback_abort_generation_{0};
+    std::atomic<int64_t> playback_abort_time_us_{0};
+    // Set by the output task, when the speaker runs out of the voice frames it took from the playback queue
+    std::atomic<int64_t> playback_dry_time_us_{0};
+    // Owned by the decoder task, opened for the first sound in the queue and closed once it runs dry
+    void* sound_decoder_ = nullptr;
+    int sound_decoder_sample_rate_ = 0;
+    int sound_decoder_duration_ms_ = 0;
+    esp_ae_rate_cvt_handle_t sound_resampler_ = nullptr;
+    // Owned by the decoder task, the cached sound being cut into effect frames
+    std::shared_ptr<const SoundCache::Entry> cached_sound_;
+    size_t cached_sound_offset_ = 0;
+    SoundCache sound_cache_{CONFIG_AUDIO_SOUND_CACHE_SIZE_KB * 1024};
+    AudioMixer audio_mixer_;
+    // Owned by the output task, one chunk of the effects bus and of the mixed output, both in chunk_storage_
+    std::vector<int16_t> chunk_storage_;
+    int16_t* effects_chunk_ = nullptr;
+    int16_t* mix_chunk_ = nullptr;
+    size_t chunk_samples_ = 0;
+    LatencyTracer latency_tracer_;
+    // Owned by the encoder task
+    ComplexityGovernor complexity_governor_{OPUS_COMPLEXITY_MIN, OPUS_COMPLEXITY_MAX};
+    // Owned by the processor output, reset when voice processing starts
+    Endpointer endpointer_{ENDPOINTER_HANGOVER_MS, ENDPOINTER_MIN_SPEECH_MS, ENDPOINTER_MAX_UTTERANCE_MS};
+    std::atomic<bool> endpointer_enabled_{false};
+    std::atomic<bool> endpointer_reset_{false};
+    bool uplink_ended_ = false;
+    // End of speech of the current turn, until the first reply packet arrives
+    std::atomic<int64_t> turn_speech_end_us_{0};
+    // Time of the last microphone read fed to the processor, the origin of the next uplink frame
+    std::atomic<int64_t> last_capture_time_us_{0};
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
@@ -163,33 +367,55 @@ private:
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
-    // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    TaskHandle_t opus_encoder_task_handle_ = nullptr;
+    TaskHandle_t opus_decoder_task_handle_ = nullptr;
+    // The decode queue is fed by the network and by PlaySound, the encode queue by the processor
+    // and by audio testing, so their producers are serialized. Consumers never take a lock.
+    std::mutex decode_producer_mutex_;
+    std::mutex encode_producer_mutex_;
+    std::mutex sound_producer_mutex_;
+    // Sized to also hold a full audio testing recording when it is replayed
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_{MAX_DECODE_PACKETS_IN_QUEUE + AUDIO_TESTING_MAX_PACKETS};
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_send_queue_{MAX_SEND_PACKETS_IN_QUEUE};
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_{AUDIO_TESTING_MAX_PACKETS};
+    SpscQueue<std::unique_ptr<AudioTask>> audio_encode_queue_{MAX_ENCODE_TASKS_IN_QUEUE};
+    SpscQueue<std::unique_ptr<AudioTask>> audio_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    // The effects bus, sounds skip the decode queue and the jitter buffer so they never wait behind TTS
+    SpscQueue<SoundFrame> audio_sound_queue_{MAX_SOUND_PACKETS_IN_QUEUE};
+    SpscQueue<std::unique_ptr<AudioTask>> audio_effects_queue_{MAX_EFFECTS_TASKS_IN_QUEUE};
+    // For server AEC, the downlink timestamp that was audible when each uplink frame was captured
+    PlaybackClock playback_clock_;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
     bool service_stopped_ = true;
-    bool audio_input_need_warmup_ = false;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
+    // Serializes power-ups from the tasks that use the codec with the power-down by the timer
+    std::mutex power_mutex_;
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void OpusEncoderTask();
+    void OpusDecoderTask();
+    bool DecodeToPlaybackQueue(const AudioStreamPacket* packet, bool recover);
+    bool DecodeSoundToEffectsQueue();
+    /// @brief Run the endpointer on an uplink frame, false once the turn has ended and the frame is dropped
+    bool EndpointUplinkFrame(size_t samples);
+    void DecodeSoundFrame(const SoundFrame& frame);
+    bool OpenSoundDecoder(int sample_rate, int frame_duration);
+    void CloseSoundDecoder();
+    bool IsPlaybackDrained() const;
+    /// @brief Copy a frame into a pooled task, the caller keeps its buffer
+    void PushTaskToEncodeQueue(AudioTaskType type, const int16_t* pcm, size_t samples);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    bool OpenEncoder(int frame_duration_ms, int complexity);
     void CheckAndUpdateAudioPowerState();
+    void EnsureInputPowered(bool predicted);
+    void EnsureOutputPowered(bool predicted);
 };
 
 #endif
\ No newline at end of file
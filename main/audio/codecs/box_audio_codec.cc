@@ -239,9 +239,26 @@ int BoxAudioCodec::Read(int16_t* dest, int samples) {
     return samples;
 }
 
+bool BoxAudioCodec::InputSettled(const int16_t* data, int samples) {
+    /* Only the microphone channel counts, the reference channel stays quiet while nothing plays */
+    for (int i = 0; i < samples; i += input_channels_) {
+        if (data[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int BoxAudioCodec::Write(const int16_t* data, int samples) {
     if (output_enabled_) {
         ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_write(output_dev_, (void*)data, samples * sizeof(int16_t)));
     }
     return samples;
+}
+
+void BoxAudioCodec::MuteOutput(bool mute) {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    if (output_enabled_ && output_dev_ != nullptr) {
+        ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_set_out_mute(output_dev_, mute));
+    }
 }
\ No newline at end of file
@@ -25,6 +25,8 @@ private:
 
     virtual int Read(int16_t* dest, int samples) override;
     virtual int Write(const int16_t* data, int samples) override;
+    virtual void MuteOutput(bool mute) override;
+    virtual bool InputSettled(const int16_t* data, int samples) override;
 
 public:
     BoxAudioCodec(void* i2c_master_handle, int input_sample_rate, int output_sample_rate,
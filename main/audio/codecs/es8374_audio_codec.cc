@@ -197,4 +197,11 @@ int Es8374AudioCodec::Write(const int16_t* data, int samples) {
         ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_write(output_dev_, (void*)data, samples * sizeof(int16_t)));
     }
     return samples;
+}
+
+void Es8374AudioCodec::MuteOutput(bool mute) {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    if (output_enabled_ && output_dev_ != nullptr) {
+        ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_set_out_mute(output_dev_, mute));
+    }
 }
\ No newline at end of file
@@ -218,3 +218,10 @@ int Es8388AudioCodec::Write(const int16_t* data, int samples) {
     }
     return samples;
 }
+
+void Es8388AudioCodec::MuteOutput(bool mute) {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    if (output_enabled_ && output_dev_ != nullptr) {
+        ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_set_out_mute(output_dev_, mute));
+    }
+}
@@ -1,4 +1,5 @@
 #include "no_audio_codec.h"
+#include "pcm_kernels.h"
 
 #include <esp_log.h>
 #include <cmath>
@@ -221,16 +222,7 @@ int NoAudioCodec::Write(const int16_t* data, int samples) {
     // output_volume_: 0-100
     // volume_factor_: 0-65536
     int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
-    for (int i = 0; i < samples; i++) {
-        int64_t temp = int64_t(data[i]) * volume_factor; // 使用 int64_t 进行乘法运算
-        if (temp > INT32_MAX) {
-            buffer[i] = INT32_MAX;
-        } else if (temp < INT32_MIN) {
-            buffer[i] = INT32_MIN;
-        } else {
-            buffer[i] = static_cast<int32_t>(temp);
-        }
-    }
+    PcmKernels::Widen(data, buffer.data(), samples, volume_factor);
 
     size_t bytes_written;
     ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer.data(), samples * sizeof(int32_t), &bytes_written, portMAX_DELAY));
@@ -247,10 +239,7 @@ int NoAudioCodec::Read(int16_t* dest, int samples) {
     }
 
     samples = bytes_read / sizeof(int32_t);
-    for (int i = 0; i < samples; i++) {
-        int32_t value = bit32_buffer[i] >> 12;
-        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
-    }
+    PcmKernels::Narrow(bit32_buffer.data(), dest, samples, 12);
     return samples;
 }
 
@@ -280,6 +269,22 @@ void NoAudioCodec::EnableOutput(bool enable) {
     AudioCodec::EnableOutput(enable);
 }
 
+void NoAudioCodec::FlushOutput() {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    if (!output_enabled_) {
+        return;
+    }
+    // Stop the DMA and overwrite the whole ring with silence before it starts again
+    static const int32_t zeros[AUDIO_CODEC_DMA_FRAME_NUM] = {};
+    ESP_ERROR_CHECK(i2s_channel_disable(tx_handle_));
+    size_t bytes_loaded = sizeof(zeros);
+    // A descriptor holds at most two 32-bit slots per frame, preload stops short once the ring is full
+    for (int i = 0; i < AUDIO_CODEC_DMA_DESC_NUM * 2 && bytes_loaded == sizeof(zeros); i++) {
+        ESP_ERROR_CHECK_WITHOUT_ABORT(i2s_channel_preload_data(tx_handle_, zeros, sizeof(zeros), &bytes_loaded));
+    }
+    ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
+}
+
 // Delegating constructor: calls the main constructor with default slot mask
 NoAudioCodecSimplexPdm::NoAudioCodecSimplexPdm(int input_sample_rate, int output_sample_rate, gpio_num_t spk_bclk, gpio_num_t spk_ws, gpio_num_t spk_dout, gpio_num_t mic_sck, gpio_num_t mic_din) 
     : NoAudioCodecSimplexPdm(input_sample_rate, output_sample_rate, spk_bclk, spk_ws, spk_dout, I2S_STD_SLOT_LEFT, mic_sck, mic_din) {
@@ -375,11 +380,7 @@ int NoAudioCodecSimplexPdm::Read(int16_t* dest, int samples) {
 
     samples = bytes_read / sizeof(int16_t);
     if (input_gain_ > 0) {
-        int gain_factor = (int)input_gain_;
-        for (int i = 0; i < samples; i++) {
-            int32_t amplified = dest[i] * gain_factor;
-            dest[i] = (amplified > INT16_MAX) ? INT16_MAX : (amplified < -INT16_MAX) ? -INT16_MAX : (int16_t)amplified;
-        }
+        PcmKernels::ApplyGain(dest, samples, (int)input_gain_);
     }
     return samples;
 }
@@ -18,6 +18,8 @@ protected:
 
 public:
     virtual ~NoAudioCodec();
+
+    virtual void FlushOutput() override;
 };
 
 class NoAudioCodecDuplex : public NoAudioCodec {
@@ -0,0 +1,194 @@
+#include "wav_audio_codec.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "WavAudioCodec"
+
+/* Fall behind by more than this and the clock restarts, e.g. after the input was disabled for a while */
+#define WAV_PACE_MAX_LAG_US 200000
+
+struct WavHeader {
+    char riff[4];
+    uint32_t riff_size;
+    char wave[4];
+    char fmt[4];
+    uint32_t fmt_size;
+    uint16_t audio_format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char data[4];
+    uint32_t data_size;
+};
+static_assert(sizeof(WavHeader) == 44, "WAV header must not be padded");
+
+WavAudioCodec::WavAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, float speed) {
+    duplex_ = true;
+    input_reference_ = false;
+    input_channels_ = 1;
+    input_sample_rate_ = 16000;
+    output_sample_rate_ = output_sample_rate;
+    speed_ = speed;
+
+    if (!input_path.empty() && !OpenInput(input_path)) {
+        ESP_LOGE(TAG, "Failed to open input %s, reading silence", input_path.c_str());
+    }
+    if (!output_path.empty() && !OpenOutput(output_path)) {
+        ESP_LOGE(TAG, "Failed to open output %s, discarding playback", output_path.c_str());
+    }
+    ESP_LOGI(TAG, "Input %d Hz x %d, output %d Hz, speed %.1f", input_sample_rate_, input_channels_,
+             output_sample_rate_, speed_);
+}
+
+WavAudioCodec::~WavAudioCodec() {
+    if (input_file_ != nullptr) {
+        fclose(input_file_);
+    }
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    if (output_file_ != nullptr) {
+        UpdateOutputHeader();
+        fclose(output_file_);
+    }
+}
+
+bool WavAudioCodec::OpenInput(const std::string& path) {
+    input_file_ = fopen(path.c_str(), "rb");
+    if (input_file_ == nullptr) {
+        return false;
+    }
+
+    char riff[12];
+    if (fread(riff, 1, sizeof(riff), input_file_) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        fclose(input_file_);
+        input_file_ = nullptr;
+        return false;
+    }
+
+    /* Walk the chunks, the data chunk is not always right after the format chunk */
+    bool has_format = false;
+    char chunk_id[4];
+    uint32_t chunk_size;
+    while (fread(chunk_id, 1, 4, input_file_) == 4 && fread(&chunk_size, sizeof(chunk_size), 1, input_file_) == 1) {
+        if (memcmp(chunk_id, "fmt ", 4) == 0 && chunk_size >= 16) {
+            uint16_t format, channels, block_align, bits_per_sample;
+            uint32_t sample_rate, byte_rate;
+            fread(&format, sizeof(format), 1, input_file_);
+            fread(&channels, sizeof(channels), 1, input_file_);
+            fread(&sample_rate, sizeof(sample_rate), 1, input_file_);
+            fread(&byte_rate, sizeof(byte_rate), 1, input_file_);
+            fread(&block_align, sizeof(block_align), 1, input_file_);
+            fread(&bits_per_sample, sizeof(bits_per_sample), 1, input_file_);
+            if (format != 1 || bits_per_sample != 16 || channels == 0) {
+                ESP_LOGE(TAG, "%s is not 16-bit PCM (format %u, %u bits)", path.c_str(), format, bits_per_sample);
+                break;
+            }
+            input_sample_rate_ = sample_rate;
+            input_channels_ = channels;
+            has_format = true;
+            fseek(input_file_, chunk_size - 16 + (chunk_size & 1), SEEK_CUR);
+        } else if (memcmp(chunk_id, "data", 4) == 0 && has_format) {
+            input_data_end_ = ftell(input_file_) + chunk_size;
+            return true;
+        } else {
+            fseek(input_file_, chunk_size + (chunk_size & 1), SEEK_CUR);
+        }
+    }
+
+    ESP_LOGE(TAG, "%s has no usable PCM data", path.c_str());
+    fclose(input_file_);
+    input_file_ = nullptr;
+    input_sample_rate_ = 16000;
+    input_channels_ = 1;
+    return false;
+}
+
+bool WavAudioCodec::OpenOutput(const std::string& path) {
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        return false;
+    }
+    output_data_size_ = 0;
+    UpdateOutputHeader();
+    return true;
+}
+
+void WavAudioCodec::UpdateOutputHeader() {
+    WavHeader header = {
+        .riff = {'R', 'I', 'F', 'F'},
+        .riff_size = (uint32_t)(output_data_size_ + sizeof(WavHeader) - 8),
+        .wave = {'W', 'A', 'V', 'E'},
+        .fmt = {'f', 'm', 't', ' '},
+        .fmt_size = 16,
+        .audio_format = 1,
+        .channels = 1,
+        .sample_rate = (uint32_t)output_sample_rate_,
+        .byte_rate = (uint32_t)(output_sample_rate_ * sizeof(int16_t)),
+        .block_align = sizeof(int16_t),
+        .bits_per_sample = 16,
+        .data = {'d', 'a', 't', 'a'},
+        .data_size = output_data_size_,
+    };
+    long position = ftell(output_file_);
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output_file_);
+    fseek(output_file_, position > (long)sizeof(header) ? position : (long)sizeof(header), SEEK_SET);
+    fflush(output_file_);
+}
+
+void WavAudioCodec::Pace(int64_t& clock_us, int samples, int sample_rate, int channels) {
+    if (speed_ <= 0 || sample_rate <= 0) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    if (clock_us == 0 || now_us - clock_us > WAV_PACE_MAX_LAG_US) {
+        clock_us = now_us;
+    }
+    clock_us += (int64_t)((int64_t)samples * 1000000 / ((int64_t)sample_rate * channels) / speed_);
+    if (clock_us > now_us) {
+        vTaskDelay(pdMS_TO_TICKS((clock_us - now_us) / 1000));
+    }
+}
+
+int WavAudioCodec::Read(int16_t* dest, int samples) {
+    size_t read = 0;
+    if (input_file_ != nullptr) {
+        long remaining = (input_data_end_ - ftell(input_file_)) / (long)sizeof(int16_t);
+        if (remaining > 0) {
+            read = fread(dest, sizeof(int16_t), std::min<long>(samples, remaining), input_file_);
+        }
+    }
+    /* The script has ended, keep the microphone alive with silence */
+    memset(dest + read, 0, (samples - read) * sizeof(int16_t));
+    Pace(input_clock_us_, samples, input_sample_rate_, input_channels_);
+    return samples;
+}
+
+int WavAudioCodec::Write(const int16_t* data, int samples) {
+    {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        if (output_file_ != nullptr) {
+            output_data_size_ += fwrite(data, sizeof(int16_t), samples, output_file_) * sizeof(int16_t);
+        }
+    }
+    Pace(output_clock_us_, samples, output_sample_rate_, 1);
+    return samples;
+}
+
+void WavAudioCodec::EnableOutput(bool enable) {
+    if (!enable) {
+        /* Keep the file playable at every pause, the session may end with a power cut */
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        if (output_file_ != nullptr) {
+            UpdateOutputHeader();
+        }
+    }
+    AudioCodec::EnableOutput(enable);
+}
@@ -0,0 +1,45 @@
+#ifndef _WAV_AUDIO_CODEC_H
+#define _WAV_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*
+ * Audio codec backed by WAV files instead of I2S, for scripted sessions without a microphone or speaker.
+ *
+ * The microphone reads a 16-bit PCM WAV file and returns silence once it is exhausted. The speaker
+ * output is written to a 16-bit mono WAV file. Both sides are paced by their sample rate divided by
+ * `speed`, a speed of 0 runs as fast as the pipeline can consume.
+ */
+class WavAudioCodec : public AudioCodec {
+private:
+    std::mutex output_mutex_;
+    FILE* input_file_ = nullptr;
+    FILE* output_file_ = nullptr;
+    long input_data_end_ = 0;
+    uint32_t output_data_size_ = 0;
+    float speed_ = 1.0f;
+    int64_t input_clock_us_ = 0;
+    int64_t output_clock_us_ = 0;
+
+    bool OpenInput(const std::string& path);
+    bool OpenOutput(const std::string& path);
+    void UpdateOutputHeader();
+    void Pace(int64_t& clock_us, int samples, int sample_rate, int channels);
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+
+public:
+    /// @param input_path WAV file played into the microphone, empty for silence at 16kHz mono
+    /// @param output_path WAV file receiving the speaker output, empty to discard it
+    WavAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, float speed = 1.0f);
+    virtual ~WavAudioCodec();
+
+    virtual void EnableOutput(bool enable) override;
+};
+
+#endif // _WAV_AUDIO_CODEC_H
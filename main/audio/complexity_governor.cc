@@ -0,0 +1,67 @@
+#include "complexity_governor.h"
+#include <esp_log.h>
+#include <algorithm>
+#include <cinttypes>
+
+#define TAG "ComplexityGovernor"
+
+/* Frames per decision, about one second of 20 ms frames */
+#define GOVERNOR_WINDOW_FRAMES 50
+/* Step down above this load or with this many frames waiting, step up below the idle load */
+#define GOVERNOR_BUSY_LOAD_PERCENT 50
+#define GOVERNOR_IDLE_LOAD_PERCENT 20
+#define GOVERNOR_BACKLOG_FRAMES 2
+/* A backlog ends the window early, but only after a few frames at the new complexity */
+#define GOVERNOR_MIN_WINDOW_FRAMES 5
+/* Idle windows in a row before stepping up, so the encoder is not reopened back and forth */
+#define GOVERNOR_IDLE_WINDOWS 3
+
+ComplexityGovernor::ComplexityGovernor(int min_complexity, int max_complexity)
+    : min_complexity_(min_complexity), max_complexity_(std::max(min_complexity, max_complexity)),
+      complexity_(min_complexity), applied_(min_complexity) {
+}
+
+int ComplexityGovernor::Update(int64_t encode_us, int frame_duration_ms, size_t backlog_frames) {
+    int complexity = complexity_.load(std::memory_order_relaxed);
+    if (min_complexity_ == max_complexity_) {
+        return complexity;
+    }
+
+    encode_us_ += encode_us;
+    audio_us_ += (int64_t)frame_duration_ms * 1000;
+    max_backlog_ = std::max(max_backlog_, backlog_frames);
+    bool backlogged = backlog_frames >= GOVERNOR_BACKLOG_FRAMES;
+    frames_++;
+    if (frames_ < GOVERNOR_WINDOW_FRAMES && !(backlogged && frames_ >= GOVERNOR_MIN_WINDOW_FRAMES)) {
+        return complexity;
+    }
+
+    uint32_t load_percent = audio_us_ > 0 ? (uint32_t)(encode_us_ * 100 / audio_us_) : 0;
+    load_percent_.store(load_percent, std::memory_order_relaxed);
+    if (complexity != applied_.load(std::memory_order_relaxed)) {
+        /* The last step is not in use yet, this window says nothing about it */
+    } else if (backlogged || load_percent > GOVERNOR_BUSY_LOAD_PERCENT) {
+        idle_windows_ = 0;
+        if (complexity > min_complexity_) {
+            complexity--;
+            step_downs_++;
+            ESP_LOGI(TAG, "Load %" PRIu32 "%%, backlog %zu, complexity down to %d", load_percent, max_backlog_, complexity);
+        }
+    } else if (load_percent < GOVERNOR_IDLE_LOAD_PERCENT && max_backlog_ == 0) {
+        if (++idle_windows_ >= GOVERNOR_IDLE_WINDOWS && complexity < max_complexity_) {
+            idle_windows_ = 0;
+            complexity++;
+            step_ups_++;
+            ESP_LOGI(TAG, "Load %" PRIu32 "%%, complexity up to %d", load_percent, complexity);
+        }
+    } else {
+        idle_windows_ = 0;
+    }
+    complexity_.store(complexity, std::memory_order_relaxed);
+
+    encode_us_ = 0;
+    audio_us_ = 0;
+    max_backlog_ = 0;
+    frames_ = 0;
+    return complexity;
+}
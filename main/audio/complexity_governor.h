@@ -0,0 +1,58 @@
+#ifndef COMPLEXITY_GOVERNOR_H
+#define COMPLEXITY_GOVERNOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Picks the Opus encoder complexity from the measured CPU load.
+ *
+ * Every encoded frame reports how long the encode took and how many frames were still waiting in
+ * the encode queue. At the end of each window the load (encode time / audio time) decides:
+ * a busy window or a backlog steps the complexity down right away, several idle windows in a row
+ * step it up, within [min_complexity, max_complexity].
+ *
+ * Reopening the encoder resets its state, so the caller applies a step only between turns and
+ * reports it with SetApplied(). Until then no further step is taken, the load is still measured
+ * at the old complexity.
+ *
+ * Update() is called by the encoder task only, the other methods may be called from any task.
+ */
+class ComplexityGovernor {
+public:
+    ComplexityGovernor(int min_complexity, int max_complexity);
+
+    /// @brief Account one encoded frame
+    /// @return the complexity for the next turn
+    int Update(int64_t encode_us, int frame_duration_ms, size_t backlog_frames);
+
+    /// @brief The encoder runs with `complexity` from now on
+    void SetApplied(int complexity) { applied_.store(complexity, std::memory_order_relaxed); }
+
+    /// @brief The complexity to use for the next turn
+    int complexity() const { return complexity_.load(std::memory_order_relaxed); }
+    /// @brief The complexity the encoder runs with
+    int applied() const { return applied_.load(std::memory_order_relaxed); }
+    uint32_t load_percent() const { return load_percent_.load(std::memory_order_relaxed); }
+    uint32_t step_ups() const { return step_ups_.load(std::memory_order_relaxed); }
+    uint32_t step_downs() const { return step_downs_.load(std::memory_order_relaxed); }
+
+private:
+    const int min_complexity_;
+    const int max_complexity_;
+    std::atomic<int> complexity_;
+    std::atomic<int> applied_;
+    std::atomic<uint32_t> load_percent_{0};
+    std::atomic<uint32_t> step_ups_{0};
+    std::atomic<uint32_t> step_downs_{0};
+
+    // Current window
+    int64_t encode_us_ = 0;
+    int64_t audio_us_ = 0;
+    size_t max_backlog_ = 0;
+    int frames_ = 0;
+    int idle_windows_ = 0;
+};
+
+#endif // COMPLEXITY_GOVERNOR_H
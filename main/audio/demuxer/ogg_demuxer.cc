@@ -26,7 +26,44 @@ void OggDemuxer::Reset()
     // 清空缓冲区数据
     memset(ctx_.header, 0, sizeof(ctx_.header));
     memset(ctx_.seg_table, 0, sizeof(ctx_.seg_table));
-    memset(ctx_.packet_buf, 0, sizeof(ctx_.packet_buf));
+    // packet_buf只在packet_len范围内有效，无需清空
+}
+
+/// @brief 输出一个完整的包，OpusHead/OpusTags在此解析
+/// @param packet 包数据，可能指向packet_buf或者输入数据
+/// @param len 包长度
+void OggDemuxer::EmitPacket(const uint8_t* packet, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (!opus_info_.head_seen) {
+        if (len >= 8 && memcmp(packet, "OpusHead", 8) == 0) {
+            opus_info_.head_seen = true;
+            if (len >= 19) {
+                opus_info_.sample_rate = packet[12] |
+                                        (packet[13] << 8) |
+                                        (packet[14] << 16) |
+                                        (packet[15] << 24);
+                ESP_LOGI(TAG, "OpusHead found, sample_rate=%d", opus_info_.sample_rate);
+            }
+            return;
+        }
+    }
+    if (!opus_info_.tags_seen) {
+        if (len >= 8 && memcmp(packet, "OpusTags", 8) == 0) {
+            opus_info_.tags_seen = true;
+            ESP_LOGI(TAG, "OpusTags found.");
+            return;
+        }
+    }
+    if (opus_info_.head_seen && opus_info_.tags_seen) {
+        if (on_demuxer_finished_) {
+            on_demuxer_finished_(packet, opus_info_.sample_rate, len);
+        }
+    } else {
+        ESP_LOGW(TAG, "当前Ogg容器未解析到OpusHead/OpusTags，丢弃");
+    }
 }
 
 /// @brief 处理数据块
@@ -151,7 +188,7 @@ size_t OggDemuxer::Process(const uint8_t* data, size_t size)
                     ctx_.bytes_needed = 4;
                     ctx_.data_offset = 0;
                 } else {
-                    ESP_LOGE(TAG, "无效的段数: %u", ctx_.seg_count);
+                    ESP_LOGE(TAG, "无效的段数: %zu", ctx_.seg_count);
                     state_ = ParseState::FIND_PAGE;
                     ctx_.bytes_needed = 4;
                     ctx_.data_offset = 0;
@@ -197,6 +234,25 @@ size_t OggDemuxer::Process(const uint8_t* data, size_t size)
             
           case ParseState::PARSE_DATA: {
             while (ctx_.seg_index < ctx_.seg_count && processed < size) {
+                // 零拷贝：包在本页内结束且完整位于本次输入中时，直接输出输入数据的指针
+                if (zero_copy_ && ctx_.packet_len == 0 && ctx_.seg_remaining == 0) {
+                    size_t end = ctx_.seg_index;
+                    size_t len = 0;
+                    while (end < ctx_.seg_count && ctx_.seg_table[end] == 255) {
+                        len += 255;
+                        end++;
+                    }
+                    if (end < ctx_.seg_count && processed + len + ctx_.seg_table[end] <= size) {
+                        len += ctx_.seg_table[end];
+                        EmitPacket(data + processed, len);
+                        processed += len;
+                        ctx_.body_offset += len;
+                        ctx_.seg_index = end + 1;
+                        continue;
+                    }
+                    // 跨页或跨输入块的包，退回到packet_buf拼接
+                }
+
                 uint8_t seg_len = ctx_.seg_table[ctx_.seg_index];
                 
                 // 检查段数据是否已经部分读取
@@ -237,43 +293,7 @@ size_t OggDemuxer::Process(const uint8_t* data, size_t size)
                 
                 if (!seg_continued) {
                     // 包结束
-                    if (ctx_.packet_len) {
-                        if (!opus_info_.head_seen) {
-                            if (ctx_.packet_len >=8 && memcmp(ctx_.packet_buf, "OpusHead", 8) == 0) {
-                                opus_info_.head_seen = true;
-                                if (ctx_.packet_len >= 19) {
-                                    opus_info_.sample_rate = ctx_.packet_buf[12] | 
-                                                            (ctx_.packet_buf[13] << 8) | 
-                                                            (ctx_.packet_buf[14] << 16) | 
-                                                            (ctx_.packet_buf[15] << 24);
-                                    ESP_LOGI(TAG, "OpusHead found, sample_rate=%d", opus_info_.sample_rate);
-                                }
-                                ctx_.packet_len = 0;
-                                ctx_.packet_continued = false;
-                                ctx_.seg_index++;
-                                ctx_.seg_remaining = 0;
-                                continue;
-                            }
-                        }
-                        if (!opus_info_.tags_seen) {
-                            if (ctx_.packet_len >= 8 && memcmp(ctx_.packet_buf, "OpusTags", 8) == 0) {
-                                opus_info_.tags_seen = true;
-                                ESP_LOGI(TAG, "OpusTags found.");
-                                ctx_.packet_len = 0;
-                                ctx_.packet_continued = false;
-                                ctx_.seg_index++;
-                                ctx_.seg_remaining = 0;
-                                continue;  
-                            }
-                        }
-                        if (opus_info_.head_seen && opus_info_.tags_seen) {
-                            if (on_demuxer_finished_) {
-                                on_demuxer_finished_(ctx_.packet_buf, opus_info_.sample_rate, ctx_.packet_len);
-                            }
-                        } else {
-                            ESP_LOGW(TAG, "当前Ogg容器未解析到OpusHead/OpusTags，丢弃");
-                        }
-                    }
+                    EmitPacket(ctx_.packet_buf, ctx_.packet_len);
                     ctx_.packet_len = 0;
                     ctx_.packet_continued = false;
                 } else {
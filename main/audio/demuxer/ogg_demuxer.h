@@ -47,13 +47,23 @@ public:
     
     size_t Process(const uint8_t* data, size_t size);
 
-    /// @brief 设置解封装完毕后回调处理函数
+    /// @brief 零拷贝模式：包完整位于一个Ogg页和一次Process()的输入中时，回调直接收到指向输入数据的指针，
+    ///        只有跨页或跨输入块的包才拷贝到packet_buf中拼接
+    /// @param enable 
+    void EnableZeroCopy(bool enable) {
+        zero_copy_ = enable;
+    }
+
+    /// @brief 设置解封装完毕后回调处理函数，data只在回调期间有效，
+    ///        零拷贝模式下它可能指向Process()的输入数据
     /// @param on_demuxer_finished 
     void OnDemuxerFinished(std::function<void(const uint8_t* data, int sample_rate, size_t len)> on_demuxer_finished) {
         on_demuxer_finished_ = on_demuxer_finished;
     }
 private:
+    void EmitPacket(const uint8_t* packet, size_t len);
 
+    bool        zero_copy_ = false;
     ParseState  state_ = ParseState::FIND_PAGE;
     context_t   ctx_;
     Opus_t      opus_info_;
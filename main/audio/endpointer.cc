@@ -0,0 +1,62 @@
+#include "endpointer.h"
+#include <esp_log.h>
+
+#define TAG "Endpointer"
+
+Endpointer::Endpointer(int hangover_ms, int min_speech_ms, int max_utterance_ms)
+    : hangover_us_((int64_t)hangover_ms * 1000), min_speech_us_((int64_t)min_speech_ms * 1000),
+      max_utterance_us_((int64_t)max_utterance_ms * 1000) {
+}
+
+void Endpointer::Reset() {
+    speech_end_us_.store(0, std::memory_order_relaxed);
+    speech_start_us_ = 0;
+    speech_us_ = 0;
+    last_frame_us_ = 0;
+    ended_ = false;
+}
+
+EndpointerEvent Endpointer::Process(bool speaking, int64_t now_us) {
+    int64_t frame_us = last_frame_us_ != 0 ? now_us - last_frame_us_ : 0;
+    last_frame_us_ = now_us;
+    if (ended_) {
+        return kEndpointerEventNone;
+    }
+
+    if (speaking) {
+        if (speech_start_us_ == 0) {
+            speech_start_us_ = now_us;
+        }
+        speech_us_ += frame_us;
+        speech_end_us_.store(0, std::memory_order_relaxed);
+        if (now_us - speech_start_us_ >= max_utterance_us_) {
+            ended_ = true;
+            ESP_LOGI(TAG, "Utterance reached %lld ms, ending the turn", (long long)(max_utterance_us_ / 1000));
+            return kEndpointerEventMaxUtterance;
+        }
+        return kEndpointerEventNone;
+    }
+
+    if (speech_start_us_ == 0) {
+        return kEndpointerEventNone;
+    }
+    int64_t speech_end_us = speech_end_us_.load(std::memory_order_relaxed);
+    if (speech_end_us == 0) {
+        speech_end_us_.store(now_us, std::memory_order_relaxed);
+        return kEndpointerEventNone;
+    }
+    if (now_us - speech_end_us < hangover_us_) {
+        return kEndpointerEventNone;
+    }
+    if (speech_us_ < min_speech_us_) {
+        short_speech_count_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGD(TAG, "Ignoring %lld ms of speech", (long long)(speech_us_ / 1000));
+        speech_start_us_ = 0;
+        speech_us_ = 0;
+        speech_end_us_.store(0, std::memory_order_relaxed);
+        return kEndpointerEventNone;
+    }
+    ended_ = true;
+    ESP_LOGI(TAG, "End of speech after %lld ms of speech", (long long)(speech_us_ / 1000));
+    return kEndpointerEventEndOfSpeech;
+}
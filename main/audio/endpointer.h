@@ -0,0 +1,51 @@
+#ifndef ENDPOINTER_H
+#define ENDPOINTER_H
+
+#include <atomic>
+#include <cstdint>
+
+enum EndpointerEvent {
+    kEndpointerEventNone,
+    kEndpointerEventEndOfSpeech,    // Silence for the hangover after enough speech
+    kEndpointerEventMaxUtterance,   // Speech went on for the maximum utterance length
+};
+
+/*
+ * Decides on the device when the user has finished speaking, from the VAD state of each uplink frame.
+ *
+ * The end of speech is confirmed once the VAD has reported silence for the hangover time, after at
+ * least the minimum speech duration. Shorter bursts (a click, a cough) are forgotten after the
+ * hangover. An utterance is cut at the maximum length even if the VAD never reports silence. Each
+ * turn ends at most once, until Reset().
+ *
+ * Process() is called by the task producing the uplink frames only, the getters may be read from any task.
+ */
+class Endpointer {
+public:
+    Endpointer(int hangover_ms, int min_speech_ms, int max_utterance_ms);
+
+    /// @brief Start a new turn
+    void Reset();
+    /// @brief Account one uplink frame
+    /// @return the end of the turn, once
+    EndpointerEvent Process(bool speaking, int64_t now_us);
+
+    /// @brief Time the current stretch of silence after speech began, 0 while speaking or before any speech
+    int64_t speech_end_us() const { return speech_end_us_.load(std::memory_order_relaxed); }
+    uint32_t short_speech_count() const { return short_speech_count_.load(std::memory_order_relaxed); }
+
+private:
+    const int64_t hangover_us_;
+    const int64_t min_speech_us_;
+    const int64_t max_utterance_us_;
+    std::atomic<int64_t> speech_end_us_{0};
+    std::atomic<uint32_t> short_speech_count_{0};
+
+    // Current turn
+    int64_t speech_start_us_ = 0;
+    int64_t speech_us_ = 0;
+    int64_t last_frame_us_ = 0;
+    bool ended_ = false;
+};
+
+#endif // ENDPOINTER_H
@@ -0,0 +1,96 @@
+#ifndef FRAME_ASSEMBLER_H
+#define FRAME_ASSEMBLER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Re-chunks a stream of samples into the fixed-size frames a consumer asks for.
+ *
+ * Buffered samples always sit contiguously in one buffer, so Peek() hands a frame out in place.
+ * Consume() only moves the read position. When an append would run past the end of the buffer,
+ * the samples still buffered (less than a frame) are moved back to the front first. That keeps the
+ * cost per frame to one copy in, instead of moving the whole remainder after every frame.
+ *
+ * The buffer is sized by Reserve() up front and only grows if more is buffered than was reserved.
+ * Not thread-safe, callers hold their own lock.
+ */
+template <typename T>
+class FrameAssembler {
+    static_assert(std::is_trivially_copyable<T>::value, "FrameAssembler moves samples with memcpy");
+
+public:
+    FrameAssembler() = default;
+    FrameAssembler(const FrameAssembler&) = delete;
+    FrameAssembler& operator=(const FrameAssembler&) = delete;
+
+    /// @brief Make room for `capacity` samples, e.g. the largest append plus one frame
+    void Reserve(size_t capacity) {
+        if (capacity > buffer_.size()) {
+            Compact();
+            buffer_.resize(capacity);
+        }
+    }
+
+    /// @brief Append samples
+    void Append(const T* data, size_t count) {
+        memcpy(Extend(count), data, count * sizeof(T));
+    }
+
+    /// @brief Append `count` samples the caller writes through the returned pointer
+    T* Extend(size_t count) {
+        if (write_ + count > buffer_.size()) {
+            Compact();
+            if (write_ + count > buffer_.size()) {
+                buffer_.resize(std::max(write_ + count, buffer_.size() * 2));
+            }
+        }
+        T* data = buffer_.data() + write_;
+        write_ += count;
+        return data;
+    }
+
+    /// @brief The next `count` samples in place, nullptr until that many are buffered
+    T* Peek(size_t count) {
+        if (size() < count) {
+            return nullptr;
+        }
+        return buffer_.data() + read_;
+    }
+
+    /// @brief Drop the first `count` buffered samples
+    void Consume(size_t count) {
+        read_ += std::min(count, size());
+        if (read_ == write_) {
+            read_ = 0;
+            write_ = 0;
+        }
+    }
+
+    void Clear() {
+        read_ = 0;
+        write_ = 0;
+    }
+
+    size_t size() const { return write_ - read_; }
+    bool empty() const { return write_ == read_; }
+
+private:
+    std::vector<T> buffer_;
+    size_t read_ = 0;
+    size_t write_ = 0;
+
+    void Compact() {
+        if (read_ == 0) {
+            return;
+        }
+        memmove(buffer_.data(), buffer_.data() + read_, size() * sizeof(T));
+        write_ -= read_;
+        read_ = 0;
+    }
+};
+
+#endif // FRAME_ASSEMBLER_H
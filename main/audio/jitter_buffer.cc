@@ -0,0 +1,176 @@
+#include "jitter_buffer.h"
+#include <esp_log.h>
+#include <algorithm>
+#include <cinttypes>
+
+#define TAG "JitterBuffer"
+
+/* A packet arriving later than this after an underrun starts a new stream instead of ending a stall */
+#define JITTER_STALL_WINDOW_MS 1000
+/* With less decoded audio than this ahead of the speaker the playback is starving, it leaves time to decode one frame */
+#define JITTER_STARVING_MS 20
+
+JitterBuffer::JitterBuffer(size_t capacity, uint32_t max_delay_ms)
+    : capacity_(capacity), max_delay_ms_(max_delay_ms), slots_(capacity) {
+}
+
+void JitterBuffer::Reset(const Release& release) {
+    for (auto& slot : slots_) {
+        if (slot) {
+            release(std::move(slot));
+            slot.reset();
+        }
+    }
+    count_.store(0, std::memory_order_relaxed);
+    state_ = kStateIdle;
+    underrun_pending_ = false;
+    gap_since_ms_ = -1;
+}
+
+std::unique_ptr<AudioStreamPacket> JitterBuffer::Put(std::unique_ptr<AudioStreamPacket> packet, int64_t now_ms) {
+    if (packet->frame_duration > 0) {
+        frame_duration_ms_ = packet->frame_duration;
+    }
+
+    bool idle = count_ == 0 && state_ != kStatePlaying;
+    uint32_t sequence = packet->sequence != 0 ? packet->sequence : (idle ? head_sequence_ : tail_sequence_);
+    if (idle) {
+        if (state_ == kStateIdle) {
+            StartStream(sequence, now_ms);
+        } else if (underrun_pending_) {
+            underrun_pending_ = false;
+            int64_t gap_ms = now_ms - underrun_ms_;
+            if (gap_ms < JITTER_STALL_WINDOW_MS) {
+                underruns_++;
+                jitter_ms_ = std::max<uint32_t>(jitter_ms_, gap_ms);
+            } else {
+                StartStream(sequence, now_ms);
+            }
+        }
+        /* Packets missed while the buffer was empty are past due, resume from this one */
+        head_sequence_ = sequence;
+        tail_sequence_ = sequence;
+        buffering_since_ms_ = now_ms;
+        state_ = kStateBuffering;
+    }
+
+    int32_t offset = (int32_t)(sequence - head_sequence_);
+    if (offset < 0 || slots_[sequence % capacity_] != nullptr) {
+        late_packets_++;
+        return packet;
+    }
+    if ((size_t)offset >= capacity_) {
+        ESP_LOGW(TAG, "Packet %" PRIu32 " is too far ahead of %" PRIu32 ", dropping", sequence, head_sequence_);
+        late_packets_++;
+        return packet;
+    }
+
+    UpdateJitter(sequence, now_ms);
+    slots_[sequence % capacity_] = std::move(packet);
+    count_++;
+    if ((int32_t)(sequence + 1 - tail_sequence_) > 0) {
+        tail_sequence_ = sequence + 1;
+    }
+    return nullptr;
+}
+
+JitterBuffer::Action JitterBuffer::Next(int64_t now_ms, uint32_t playback_ahead_ms,
+                                        std::unique_ptr<AudioStreamPacket>& packet, uint32_t& wait_ms) {
+    wait_ms = UINT32_MAX;
+    bool playback_starving = playback_ahead_ms <= JITTER_STARVING_MS;
+    uint32_t until_starving_ms = playback_starving ? 0 : playback_ahead_ms - JITTER_STARVING_MS;
+    if (count_ == 0) {
+        /* The playback ran dry, buffer up to the target again before resuming */
+        if (state_ == kStatePlaying) {
+            if (!playback_starving) {
+                wait_ms = until_starving_ms;
+                return kJitterActionWait;
+            }
+            state_ = kStateBuffering;
+            underrun_pending_ = true;
+            underrun_ms_ = now_ms;
+        }
+        return kJitterActionWait;
+    }
+
+    if (state_ != kStatePlaying) {
+        int64_t elapsed_ms = now_ms - buffering_since_ms_;
+        uint32_t target_ms = TargetDelayMs();
+        if (count_ < TargetFrames() && elapsed_ms < target_ms) {
+            wait_ms = target_ms - elapsed_ms;
+            return kJitterActionWait;
+        }
+        state_ = kStatePlaying;
+    }
+
+    auto& slot = slots_[head_sequence_ % capacity_];
+    if (slot) {
+        packet = std::move(slot);
+        head_sequence_++;
+        count_--;
+        gap_since_ms_ = -1;
+        return kJitterActionDecode;
+    }
+
+    /* The next packet is missing but later ones have arrived. It may only have been overtaken, so
+     * give it the target delay, or one frame, to show up unless the speaker is about to run dry. */
+    if (gap_since_ms_ < 0) {
+        gap_since_ms_ = now_ms;
+    }
+    uint32_t patience_ms = std::max<uint32_t>(TargetDelayMs(), frame_duration_ms_);
+    uint32_t waited_ms = now_ms - gap_since_ms_;
+    if (playback_starving || waited_ms >= patience_ms) {
+        head_sequence_++;
+        concealed_++;
+        gap_since_ms_ = -1;
+        return kJitterActionConceal;
+    }
+    wait_ms = std::min(patience_ms - waited_ms, until_starving_ms);
+    return kJitterActionWait;
+}
+
+const AudioStreamPacket* JitterBuffer::Peek() const {
+    return slots_[head_sequence_ % capacity_].get();
+}
+
+JitterBuffer::Statistics JitterBuffer::statistics() const {
+    Statistics statistics;
+    statistics.target_delay_ms = target_delay_ms_;
+    statistics.jitter_ms = jitter_ms_;
+    statistics.underruns = underruns_;
+    statistics.concealed = concealed_;
+    statistics.late_packets = late_packets_;
+    return statistics;
+}
+
+void JitterBuffer::StartStream(uint32_t sequence, int64_t now_ms) {
+    stream_first_sequence_ = sequence;
+    base_offset_ms_ = now_ms;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_ms) {
+    /* How much later than the earliest packet of this stream did this one arrive, relative to its media time */
+    int64_t media_ms = (int64_t)(int32_t)(sequence - stream_first_sequence_) * frame_duration_ms_;
+    int64_t offset_ms = now_ms - media_ms;
+    if (offset_ms < base_offset_ms_) {
+        base_offset_ms_ = offset_ms;
+    }
+    uint32_t lateness_ms = offset_ms - base_offset_ms_;
+
+    /* Peak hold with a slow decay, so the target shrinks again after a few seconds of a steady network */
+    jitter_ms_ -= (jitter_ms_ + 63) / 64;
+    if (lateness_ms > jitter_ms_) {
+        jitter_ms_ = lateness_ms;
+    }
+    target_delay_ms_ = TargetDelayMs();
+}
+
+uint32_t JitterBuffer::TargetDelayMs() const {
+    uint32_t limit_ms = std::min<uint32_t>(max_delay_ms_, (capacity_ - 1) * frame_duration_ms_);
+    return std::min(jitter_ms_, limit_ms);
+}
+
+size_t JitterBuffer::TargetFrames() const {
+    size_t frames = (TargetDelayMs() + frame_duration_ms_ - 1) / frame_duration_ms_;
+    return std::max<size_t>(frames, 1);
+}
@@ -0,0 +1,106 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "protocol.h"
+
+/*
+ * Adaptive jitter buffer in front of the Opus decoder.
+ *
+ * Packets are ordered by AudioStreamPacket::sequence, packets without a sequence number are
+ * played in arrival order. The target delay follows the measured arrival jitter: every packet is
+ * compared with the earliest arrival seen in the current stream, and a stall that drains the
+ * playback queue adds its length. The estimate decays while the network is quiet, and the
+ * target is applied when a stream starts or after an underrun.
+ *
+ * A missing packet is waited for while later ones arrive, for the target delay but at least one
+ * frame, since a packet that was merely overtaken shows up within that time. It is concealed
+ * earlier only if the audio already decoded for the speaker is about to run out.
+ *
+ * The buffer is owned by the decoder task. Only size() and statistics() may be read from other
+ * tasks.
+ */
+class JitterBuffer {
+public:
+    enum Action {
+        kJitterActionWait,      // Nothing to play yet
+        kJitterActionDecode,    // Decode the returned packet
+        kJitterActionConceal,   // The next packet is lost, conceal it with PLC or FEC
+    };
+
+    struct Statistics {
+        uint32_t target_delay_ms = 0;
+        uint32_t jitter_ms = 0;
+        uint32_t underruns = 0;
+        uint32_t concealed = 0;
+        uint32_t late_packets = 0;
+    };
+
+    using Release = std::function<void(std::unique_ptr<AudioStreamPacket>&&)>;
+
+    JitterBuffer(size_t capacity, uint32_t max_delay_ms);
+
+    /// @brief Drop every buffered packet and wait for a new stream
+    void Reset(const Release& release);
+
+    /// @brief Add an arrived packet
+    /// @return the packet if it arrived too late to be played, the caller releases it
+    std::unique_ptr<AudioStreamPacket> Put(std::unique_ptr<AudioStreamPacket> packet, int64_t now_ms);
+
+    /// @brief Decide what the decoder plays next
+    /// @param playback_ahead_ms how long the decoded audio not yet played lasts
+    /// @param packet receives the packet to decode for kJitterActionDecode
+    /// @param wait_ms for kJitterActionWait, how long to wait at most before calling again (UINT32_MAX for no limit)
+    Action Next(int64_t now_ms, uint32_t playback_ahead_ms, std::unique_ptr<AudioStreamPacket>& packet, uint32_t& wait_ms);
+
+    /// @brief The packet that will be played next if it has arrived, used for in-band FEC
+    const AudioStreamPacket* Peek() const;
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= capacity_; }
+    Statistics statistics() const;
+
+private:
+    enum State {
+        kStateIdle,
+        kStateBuffering,
+        kStatePlaying,
+    };
+
+    const size_t capacity_;
+    const uint32_t max_delay_ms_;
+    std::vector<std::unique_ptr<AudioStreamPacket>> slots_;
+    std::atomic<size_t> count_{0};
+    State state_ = kStateIdle;
+    uint32_t head_sequence_ = 0;    // Next sequence to play
+    uint32_t tail_sequence_ = 0;    // One past the highest sequence buffered
+    int frame_duration_ms_ = 60;
+    int64_t gap_since_ms_ = -1;     // When the missing head packet was first waited for, -1 if the head is not missing
+
+    // Jitter estimation
+    uint32_t stream_first_sequence_ = 0;
+    int64_t base_offset_ms_ = 0;
+    int64_t buffering_since_ms_ = 0;
+    int64_t underrun_ms_ = 0;
+    bool underrun_pending_ = false;
+    uint32_t jitter_ms_ = 0;
+
+    std::atomic<uint32_t> underruns_{0};
+    std::atomic<uint32_t> concealed_{0};
+    std::atomic<uint32_t> late_packets_{0};
+    std::atomic<uint32_t> target_delay_ms_{0};
+
+    void StartStream(uint32_t sequence, int64_t now_ms);
+    void UpdateJitter(uint32_t sequence, int64_t now_ms);
+    uint32_t TargetDelayMs() const;
+    size_t TargetFrames() const;
+};
+
+#endif // JITTER_BUFFER_H
@@ -0,0 +1,103 @@
+#include "latency_tracer.h"
+#include <algorithm>
+
+/* Upper bound of each bucket in milliseconds, the last bucket takes everything above */
+static const uint32_t kBucketBoundsMs[LATENCY_BUCKET_COUNT - 1] = {5, 10, 20, 50, 100, 200, 500, 1000, 2000};
+
+static const char* const kStageNames[kLatencyStageCount] = {
+    "processor",
+    "encode_queue",
+    "encode",
+    "send_queue",
+    "send",
+    "uplink",
+    "jitter_buffer",
+    "decode",
+    "playback",
+    "downlink",
+};
+
+void LatencyTracer::Record(LatencyStage stage, int64_t since_us) {
+    if (since_us <= 0) {
+        return;
+    }
+    int64_t elapsed_us = Now() - since_us;
+    uint32_t elapsed_ms = elapsed_us > 0 ? (uint32_t)(elapsed_us / 1000) : 0;
+
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKET_COUNT - 1 && elapsed_ms > kBucketBoundsMs[bucket]) {
+        bucket++;
+    }
+
+    auto& histogram = histograms_[stage];
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.sum_ms.fetch_add(elapsed_ms, std::memory_order_relaxed);
+    uint32_t max_ms = histogram.max_ms.load(std::memory_order_relaxed);
+    while (elapsed_ms > max_ms && !histogram.max_ms.compare_exchange_weak(max_ms, elapsed_ms, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyTracer::Reset() {
+    for (auto& histogram : histograms_) {
+        for (auto& bucket : histogram.buckets) {
+            bucket = 0;
+        }
+        histogram.count = 0;
+        histogram.sum_ms = 0;
+        histogram.max_ms = 0;
+    }
+}
+
+uint32_t LatencyTracer::Percentile(const Histogram& histogram, int percent) {
+    uint32_t count = histogram.count.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+    /* Report the upper bound of the bucket that holds the percentile, or the max for the last bucket */
+    uint32_t rank = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += histogram.buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(kBucketBoundsMs[i], histogram.max_ms.load(std::memory_order_relaxed));
+        }
+    }
+    return histogram.max_ms.load(std::memory_order_relaxed);
+}
+
+cJSON* LatencyTracer::GetHistogramJson() const {
+    auto root = cJSON_CreateObject();
+    auto bounds = cJSON_CreateArray();
+    for (auto bound : kBucketBoundsMs) {
+        cJSON_AddItemToArray(bounds, cJSON_CreateNumber(bound));
+    }
+    cJSON_AddItemToObject(root, "bucket_bounds_ms", bounds);
+
+    for (int stage = 0; stage < kLatencyStageCount; stage++) {
+        auto& histogram = histograms_[stage];
+        uint32_t count = histogram.count.load(std::memory_order_relaxed);
+        auto item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "count", count);
+        cJSON_AddNumberToObject(item, "avg_ms", count > 0 ? histogram.sum_ms.load(std::memory_order_relaxed) / count : 0);
+        cJSON_AddNumberToObject(item, "max_ms", histogram.max_ms.load(std::memory_order_relaxed));
+        cJSON_AddNumberToObject(item, "p50_ms", Percentile(histogram, 50));
+        cJSON_AddNumberToObject(item, "p95_ms", Percentile(histogram, 95));
+        auto buckets = cJSON_CreateArray();
+        for (auto& bucket : histogram.buckets) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(bucket.load(std::memory_order_relaxed)));
+        }
+        cJSON_AddItemToObject(item, "buckets", buckets);
+        cJSON_AddItemToObject(root, kStageNames[stage], item);
+    }
+    return root;
+}
+
+cJSON* LatencyTracer::GetSummaryJson() const {
+    auto root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "uplink_p50_ms", Percentile(histograms_[kLatencyStageUplink], 50));
+    cJSON_AddNumberToObject(root, "uplink_p95_ms", Percentile(histograms_[kLatencyStageUplink], 95));
+    cJSON_AddNumberToObject(root, "downlink_p50_ms", Percentile(histograms_[kLatencyStageDownlink], 50));
+    cJSON_AddNumberToObject(root, "downlink_p95_ms", Percentile(histograms_[kLatencyStageDownlink], 95));
+    return root;
+}
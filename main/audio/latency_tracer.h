@@ -0,0 +1,62 @@
+#ifndef LATENCY_TRACER_H
+#define LATENCY_TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <cJSON.h>
+#include <esp_timer.h>
+
+/*
+ * Per-stage audio latency histograms.
+ *
+ * Frames carry the time they entered the pipeline and the time they entered their current stage,
+ * every stage records how long the frame spent in it. Buckets are fixed so recording is lock free
+ * and can be done from any task.
+ */
+enum LatencyStage {
+    // Uplink: mic read -> processor output -> encoder -> send queue -> protocol
+    kLatencyStageProcessor,
+    kLatencyStageEncodeQueue,
+    kLatencyStageEncode,
+    kLatencyStageSendQueue,
+    kLatencyStageSend,
+    kLatencyStageUplink,
+    // Downlink: protocol receive -> jitter buffer -> decoder -> playback write
+    kLatencyStageJitterBuffer,
+    kLatencyStageDecode,
+    kLatencyStagePlayback,
+    kLatencyStageDownlink,
+    kLatencyStageCount,
+};
+
+#define LATENCY_BUCKET_COUNT 10
+
+class LatencyTracer {
+public:
+    static int64_t Now() { return esp_timer_get_time(); }
+
+    /// @brief Record the time elapsed since `since_us`, frames without a start time (0) are ignored
+    void Record(LatencyStage stage, int64_t since_us);
+    void Reset();
+
+    /// @brief Count, average, max, percentiles and buckets of every stage
+    cJSON* GetHistogramJson() const;
+    /// @brief Median and 95th percentile of the end-to-end uplink and downlink latency
+    cJSON* GetSummaryJson() const;
+
+private:
+    struct Histogram {
+        std::atomic<uint32_t> buckets[LATENCY_BUCKET_COUNT] = {};
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> sum_ms{0};
+        std::atomic<uint32_t> max_ms{0};
+    };
+
+    Histogram histograms_[kLatencyStageCount];
+
+    static uint32_t Percentile(const Histogram& histogram, int percent);
+};
+
+#endif // LATENCY_TRACER_H
@@ -0,0 +1,73 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Fixed-capacity pool of preallocated objects.
+ *
+ * All objects are created by the factory in Initialize(), so buffers reserved by the factory are
+ * reused from frame to frame. When the pool runs dry Acquire() falls back to the factory and
+ * counts the event, the extra object is freed when it is released into a full pool.
+ */
+template <typename T>
+class ObjectPool {
+public:
+    using Factory = std::function<std::unique_ptr<T>()>;
+
+    void Initialize(size_t capacity, Factory factory) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        factory_ = factory;
+        capacity_ = capacity;
+        free_.clear();
+        free_.reserve(capacity);
+        for (size_t i = 0; i < capacity; i++) {
+            free_.push_back(factory_());
+        }
+    }
+
+    std::unique_ptr<T> Acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            auto object = std::move(free_.back());
+            free_.pop_back();
+            return object;
+        }
+        exhausted_count_++;
+        lock.unlock();
+        return factory_ ? factory_() : std::make_unique<T>();
+    }
+
+    void Release(std::unique_ptr<T> object) {
+        if (object == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < capacity_) {
+            free_.push_back(std::move(object));
+        }
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t available() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_.size();
+    }
+    /// @brief Number of Acquire() calls that found the pool empty
+    uint32_t exhausted_count() const { return exhausted_count_; }
+
+private:
+    std::mutex mutex_;
+    Factory factory_;
+    size_t capacity_ = 0;
+    std::vector<std::unique_ptr<T>> free_;
+    std::atomic<uint32_t> exhausted_count_{0};
+};
+
+#endif // OBJECT_POOL_H
@@ -0,0 +1,287 @@
+#include "pcm_kernels.h"
+
+#include <sdkconfig.h>
+#include <algorithm>
+#include <cstring>
+
+#define PCM_SAMPLE_MAX 32767
+
+#if CONFIG_IDF_TARGET_ESP32S3
+#define PCM_KERNELS_PIE 1
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+#define PCM_KERNELS_VECTOR 1
+#endif
+
+static inline int16_t Saturate(int32_t value) {
+    return (int16_t)std::min<int32_t>(std::max<int32_t>(value, -PCM_SAMPLE_MAX), PCM_SAMPLE_MAX);
+}
+
+#if PCM_KERNELS_PIE
+/*
+ * ESP32-S3 PIE, 8 samples per 128-bit register. The loads and stores ignore the low 4 address bits,
+ * so the blocks only run on 16-byte aligned buffers. They return the samples done, the scalar loop
+ * does the rest.
+ */
+#define PIE_BLOCK_SAMPLES 8
+
+static inline bool PieAligned(const void* a, const void* b) {
+    return (((uintptr_t)a | (uintptr_t)b) & 15) == 0;
+}
+
+/* dest = max(dest + src saturated, -32767), the max keeps the scalar clamp */
+static size_t MixUnityPie(const int16_t* src, int16_t* dest, size_t samples) {
+    size_t blocks = samples / PIE_BLOCK_SAMPLES;
+    if (blocks == 0 || !PieAligned(src, dest)) {
+        return 0;
+    }
+    static const int16_t floor = -PCM_SAMPLE_MAX;
+    const int16_t* in = src;
+    const int16_t* acc = dest;
+    int16_t* out = dest;
+    asm volatile (
+        "ee.vldbc.16 q2, %[floor]\n"
+        "loopgtz %[blocks], 1f\n"
+        "ee.vld.128.ip q0, %[in], 16\n"
+        "ee.vld.128.ip q1, %[acc], 16\n"
+        "ee.vadds.s16 q0, q0, q1\n"
+        "ee.vmax.s16 q0, q0, q2\n"
+        "ee.vst.128.ip q0, %[out], 16\n"
+        "1:\n"
+        : [in] "+r"(in), [acc] "+r"(acc), [out] "+r"(out)
+        : [blocks] "r"(blocks), [floor] "r"(&floor)
+        : "memory");
+    return blocks * PIE_BLOCK_SAMPLES;
+}
+
+/* Two registers of stereo frames are unzipped into the even (left) and odd (right) samples */
+static size_t ExtractStereoPie(const int16_t* src, int16_t* dest, size_t frames, int channel) {
+    size_t blocks = frames / PIE_BLOCK_SAMPLES;
+    if (blocks == 0 || !PieAligned(src, dest)) {
+        return 0;
+    }
+    const int16_t* in = src;
+    int16_t* out = dest;
+    if (channel == 0) {
+        asm volatile (
+            "loopgtz %[blocks], 1f\n"
+            "ee.vld.128.ip q0, %[in], 16\n"
+            "ee.vld.128.ip q1, %[in], 16\n"
+            "ee.vunzip.16 q0, q1\n"
+            "ee.vst.128.ip q0, %[out], 16\n"
+            "1:\n"
+            : [in] "+r"(in), [out] "+r"(out)
+            : [blocks] "r"(blocks)
+            : "memory");
+    } else {
+        asm volatile (
+            "loopgtz %[blocks], 1f\n"
+            "ee.vld.128.ip q0, %[in], 16\n"
+            "ee.vld.128.ip q1, %[in], 16\n"
+            "ee.vunzip.16 q0, q1\n"
+            "ee.vst.128.ip q1, %[out], 16\n"
+            "1:\n"
+            : [in] "+r"(in), [out] "+r"(out)
+            : [blocks] "r"(blocks)
+            : "memory");
+    }
+    return blocks * PIE_BLOCK_SAMPLES;
+}
+#endif
+
+#if PCM_KERNELS_VECTOR
+/*
+ * GCC vector extensions. Only the channel pick has a vector path here: the compiler already
+ * vectorizes the arithmetic loops on these hosts, a hand-written path was slower there.
+ * Loads and stores go through memcpy, so the buffers need no alignment.
+ */
+typedef int16_t VectorS16 __attribute__((vector_size(16)));
+#define VECTOR_BLOCK_SAMPLES 8
+
+/* Both halves of the block are loaded before the store, so in place works too */
+static size_t ExtractStereoVector(const int16_t* src, int16_t* dest, size_t frames, int channel) {
+    size_t i = 0;
+    for (; i + VECTOR_BLOCK_SAMPLES <= frames; i += VECTOR_BLOCK_SAMPLES) {
+        VectorS16 a, b, value;
+        memcpy(&a, src + i * 2, sizeof(a));
+        memcpy(&b, src + i * 2 + VECTOR_BLOCK_SAMPLES, sizeof(b));
+        if (channel == 0) {
+            value = __builtin_shufflevector(a, b, 0, 2, 4, 6, 8, 10, 12, 14);
+        } else {
+            value = __builtin_shufflevector(a, b, 1, 3, 5, 7, 9, 11, 13, 15);
+        }
+        memcpy(dest + i, &value, sizeof(value));
+    }
+    return i;
+}
+#endif
+
+void PcmKernels::ApplyGain(int16_t* data, size_t samples, int gain) {
+    if (gain == 1) {
+        return;
+    }
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        data[i] = Saturate(data[i] * gain);
+        data[i + 1] = Saturate(data[i + 1] * gain);
+        data[i + 2] = Saturate(data[i + 2] * gain);
+        data[i + 3] = Saturate(data[i + 3] * gain);
+    }
+    for (; i < samples; i++) {
+        data[i] = Saturate(data[i] * gain);
+    }
+}
+
+void PcmKernels::Scale(int16_t* data, size_t samples, int32_t gain_q15) {
+    gain_q15 = std::min<int32_t>(std::max<int32_t>(gain_q15, -65535), 65535);
+    if (gain_q15 == 32768) {
+        return;
+    }
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        data[i] = Saturate((data[i] * gain_q15 + 0x4000) >> 15);
+        data[i + 1] = Saturate((data[i + 1] * gain_q15 + 0x4000) >> 15);
+        data[i + 2] = Saturate((data[i + 2] * gain_q15 + 0x4000) >> 15);
+        data[i + 3] = Saturate((data[i + 3] * gain_q15 + 0x4000) >> 15);
+    }
+    for (; i < samples; i++) {
+        data[i] = Saturate((data[i] * gain_q15 + 0x4000) >> 15);
+    }
+}
+
+void PcmKernels::Mix(const int16_t* src, int16_t* dest, size_t samples, int32_t gain_q15) {
+    gain_q15 = std::min<int32_t>(std::max<int32_t>(gain_q15, -65535), 65535);
+    size_t done = 0;
+#if PCM_KERNELS_PIE
+    if (gain_q15 == 32768) {
+        done = MixUnityPie(src, dest, samples);
+    }
+#endif
+    Scalar::Mix(src + done, dest + done, samples - done, gain_q15);
+}
+
+void PcmKernels::Narrow(const int32_t* src, int16_t* dest, size_t samples, int shift) {
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        int32_t a = src[i] >> shift;
+        int32_t b = src[i + 1] >> shift;
+        int32_t c = src[i + 2] >> shift;
+        int32_t d = src[i + 3] >> shift;
+        dest[i] = Saturate(a);
+        dest[i + 1] = Saturate(b);
+        dest[i + 2] = Saturate(c);
+        dest[i + 3] = Saturate(d);
+    }
+    for (; i < samples; i++) {
+        dest[i] = Saturate(src[i] >> shift);
+    }
+}
+
+void PcmKernels::Widen(const int16_t* src, int32_t* dest, size_t samples, int32_t gain_q16) {
+    /* 32767 * 65536 still fits, so no 64-bit product and no clamp is needed */
+    gain_q16 = std::min<int32_t>(std::max<int32_t>(gain_q16, 0), 65536);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        dest[i] = src[i] * gain_q16;
+        dest[i + 1] = src[i + 1] * gain_q16;
+        dest[i + 2] = src[i + 2] * gain_q16;
+        dest[i + 3] = src[i + 3] * gain_q16;
+    }
+    for (; i < samples; i++) {
+        dest[i] = src[i] * gain_q16;
+    }
+}
+
+void PcmKernels::ExtractChannel(const int16_t* src, int16_t* dest, size_t frames, int channels, int channel) {
+    size_t done = 0;
+    if (channels == 2) {
+#if PCM_KERNELS_PIE
+        done = ExtractStereoPie(src, dest, frames, channel);
+#elif PCM_KERNELS_VECTOR
+        done = ExtractStereoVector(src, dest, frames, channel);
+#endif
+    }
+    Scalar::ExtractChannel(src + done * channels, dest + done, frames - done, channels, channel);
+}
+
+void PcmKernels::DownmixToMono(const int16_t* src, int16_t* dest, size_t frames, int channels) {
+    if (channels <= 1) {
+        ExtractChannel(src, dest, frames, 1, 0);
+        return;
+    }
+
+    size_t i = 0;
+    if (channels == 2) {
+        for (; i + 2 <= frames; i += 2) {
+            int32_t a = (src[i * 2] + src[i * 2 + 1]) >> 1;
+            int32_t b = (src[i * 2 + 2] + src[i * 2 + 3]) >> 1;
+            dest[i] = Saturate(a);
+            dest[i + 1] = Saturate(b);
+        }
+        for (; i < frames; i++) {
+            dest[i] = Saturate((src[i * 2] + src[i * 2 + 1]) >> 1);
+        }
+        return;
+    }
+    for (; i < frames; i++) {
+        const int16_t* frame = src + i * channels;
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += frame[c];
+        }
+        dest[i] = Saturate(sum / channels);
+    }
+}
+
+void PcmKernels::SwapBytes16(uint16_t* data, size_t count) {
+    size_t i = 0;
+    /* Two words per 32-bit load */
+    for (; i + 2 <= count; i += 2) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(word));
+        word = ((word & 0x00FF00FF) << 8) | ((word >> 8) & 0x00FF00FF);
+        memcpy(data + i, &word, sizeof(word));
+    }
+    if (i < count) {
+        data[i] = __builtin_bswap16(data[i]);
+    }
+}
+
+void PcmKernels::Scalar::Mix(const int16_t* src, int16_t* dest, size_t samples, int32_t gain_q15) {
+    gain_q15 = std::min<int32_t>(std::max<int32_t>(gain_q15, -65535), 65535);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        dest[i] = Saturate(dest[i] + ((src[i] * gain_q15 + 0x4000) >> 15));
+        dest[i + 1] = Saturate(dest[i + 1] + ((src[i + 1] * gain_q15 + 0x4000) >> 15));
+        dest[i + 2] = Saturate(dest[i + 2] + ((src[i + 2] * gain_q15 + 0x4000) >> 15));
+        dest[i + 3] = Saturate(dest[i + 3] + ((src[i + 3] * gain_q15 + 0x4000) >> 15));
+    }
+    for (; i < samples; i++) {
+        dest[i] = Saturate(dest[i] + ((src[i] * gain_q15 + 0x4000) >> 15));
+    }
+}
+
+void PcmKernels::Scalar::ExtractChannel(const int16_t* src, int16_t* dest, size_t frames, int channels, int channel) {
+    if (channels <= 1) {
+        if (dest != src) {
+            memmove(dest, src, frames * sizeof(int16_t));
+        }
+        return;
+    }
+
+    size_t i = 0;
+    if (channels == 2) {
+        /* One 32-bit load per stereo frame, the wanted channel is a half word (little endian) */
+        const int shift = channel * 16;
+        for (; i + 4 <= frames; i += 4) {
+            uint32_t words[4];
+            memcpy(words, src + i * 2, sizeof(words));
+            dest[i] = (int16_t)(words[0] >> shift);
+            dest[i + 1] = (int16_t)(words[1] >> shift);
+            dest[i + 2] = (int16_t)(words[2] >> shift);
+            dest[i + 3] = (int16_t)(words[3] >> shift);
+        }
+    }
+    for (; i < frames; i++) {
+        dest[i] = src[i * channels + channel];
+    }
+}
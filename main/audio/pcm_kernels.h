@@ -0,0 +1,52 @@
+#ifndef PCM_KERNELS_H
+#define PCM_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Per-sample loops that run on every 10 ms of audio, kept in one place.
+ *
+ * Results are clamped to +/-32767 (not -32768), so a sample can always be negated. Kernels that take
+ * a source and a destination also work in place (dest == src), the destination never runs ahead of
+ * the source.
+ *
+ * The loops are written for the 32-bit cores they run on: two samples per 32-bit load where the
+ * layout allows it, and clamps the compiler turns into the MIN/MAX instructions of Xtensa and
+ * RISC-V instead of branches.
+ *
+ * Mix() and ExtractChannel() have SIMD paths for whole blocks, the scalar loops in PcmKernels::Scalar
+ * do the rest and everything on targets without one. The paths give the same results sample for sample:
+ * -   ESP32-S3: PIE instructions for Mix() at unity gain and ExtractChannel() of stereo, when both
+ *     buffers are 16-byte aligned.
+ * -   Hosts with SSE2 or NEON: GCC vector extensions for ExtractChannel() of stereo, checked against
+ *     Scalar by the host tests.
+ */
+class PcmKernels {
+public:
+    /// @brief data *= gain, saturating
+    static void ApplyGain(int16_t* data, size_t samples, int gain);
+    /// @brief data *= gain_q15 / 32768 with rounding, saturating, |gain_q15| < 65536 (below 2.0)
+    static void Scale(int16_t* data, size_t samples, int32_t gain_q15);
+    /// @brief dest += src * gain_q15 / 32768, saturating, same gain range as Scale()
+    static void Mix(const int16_t* src, int16_t* dest, size_t samples, int32_t gain_q15);
+    /// @brief dest = src >> shift, saturating, for 32-bit I2S slots
+    static void Narrow(const int32_t* src, int16_t* dest, size_t samples, int shift);
+    /// @brief dest = src * gain_q16, 0 <= gain_q16 <= 65536 (unity), for 32-bit I2S slots
+    static void Widen(const int16_t* src, int32_t* dest, size_t samples, int32_t gain_q16);
+    /// @brief Copy one channel out of interleaved frames
+    static void ExtractChannel(const int16_t* src, int16_t* dest, size_t frames, int channels, int channel);
+    /// @brief Average all channels of interleaved frames
+    static void DownmixToMono(const int16_t* src, int16_t* dest, size_t frames, int channels);
+    /// @brief Swap the bytes of every 16-bit word, e.g. RGB565 pixels for a big-endian consumer
+    static void SwapBytes16(uint16_t* data, size_t count);
+
+    /// @brief The plain loops of the kernels that have a SIMD path, the reference for the host tests
+    class Scalar {
+    public:
+        static void Mix(const int16_t* src, int16_t* dest, size_t samples, int32_t gain_q15);
+        static void ExtractChannel(const int16_t* src, int16_t* dest, size_t frames, int channels, int channel);
+    };
+};
+
+#endif // PCM_KERNELS_H
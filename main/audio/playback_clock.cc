@@ -0,0 +1,124 @@
+#include "playback_clock.h"
+#include <algorithm>
+
+void PlaybackClock::Configure(int sample_rate, size_t buffer_samples, size_t descriptor_samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sample_rate_ = sample_rate;
+    buffer_samples_ = buffer_samples;
+    descriptor_us_ = sample_rate > 0 ? (int64_t)descriptor_samples * 1000000 / sample_rate : 0;
+    written_ = 0;
+    write_count_ = 0;
+    write_head_ = 0;
+    mark_count_ = 0;
+    mark_head_ = 0;
+}
+
+void PlaybackClock::Reset(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    /* The flushed samples never play, playout continues from what is written next */
+    AddWrite(now_us, written_, now_us);
+    mark_count_ = 0;
+    mark_head_ = 0;
+}
+
+void PlaybackClock::MarkTimestamp(uint32_t timestamp_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mark_count_ > 0 && MarkAt(mark_count_ - 1).sample == written_) {
+        marks_[(mark_head_ + mark_count_ - 1) % kMaxMarks].timestamp_ms = timestamp_ms;
+        return;
+    }
+    if (mark_count_ < kMaxMarks) {
+        mark_count_++;
+    } else {
+        mark_head_ = (mark_head_ + 1) % kMaxMarks;
+    }
+    marks_[(mark_head_ + mark_count_ - 1) % kMaxMarks] = {written_, timestamp_ms};
+}
+
+void PlaybackClock::OnWritten(size_t samples, int64_t start_us, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sample_rate_ <= 0) {
+        return;
+    }
+    bool blocked = now_us - start_us >= kBlockedUs;
+    int64_t position;
+    int64_t playout_us = now_us;
+    if (write_count_ > 0 && now_us < WriteAt(write_count_ - 1).start_us) {
+        /* Still waiting for the descriptor after the DMA ran dry */
+        position = WriteAt(write_count_ - 1).position;
+        playout_us = WriteAt(write_count_ - 1).start_us;
+    } else {
+        position = PositionAt(now_us);
+        if (position < 0) {
+            /* The DMA ran dry, the new samples start after the descriptor playing silence */
+            position = written_;
+            playout_us = now_us + descriptor_us_;
+        }
+    }
+    written_ += samples;
+    /* The write returned, so no more than the DMA buffer is still queued. If it had to wait for a
+     * free descriptor, the DMA is playing and exactly the buffer is queued, which also pulls back an
+     * estimate that ran ahead after a stall it took for none. */
+    int64_t queued_floor = written_ - buffer_samples_;
+    if (position < queued_floor || (blocked && queued_floor >= 0)) {
+        position = queued_floor;
+        playout_us = now_us;
+    }
+    AddWrite(now_us, position, playout_us);
+}
+
+void PlaybackClock::AddWrite(int64_t time_us, int64_t position, int64_t start_us) {
+    if (write_count_ < kMaxWrites) {
+        write_count_++;
+    } else {
+        write_head_ = (write_head_ + 1) % kMaxWrites;
+    }
+    writes_[(write_head_ + write_count_ - 1) % kMaxWrites] = {time_us, position, start_us, written_};
+}
+
+int64_t PlaybackClock::PositionAt(int64_t time_us) const {
+    /* The last write at or before the time, then run at the sample rate up to the next write */
+    size_t i = write_count_;
+    while (i > 0 && WriteAt(i - 1).time_us > time_us) {
+        i--;
+    }
+    if (i == 0) {
+        return -1;
+    }
+    const Write& from = WriteAt(i - 1);
+    if (time_us < from.start_us) {
+        return -1;
+    }
+    int64_t position = from.position + (time_us - from.start_us) * sample_rate_ / 1000000;
+    if (position >= from.written) {
+        return -1;
+    }
+    if (i < write_count_) {
+        position = std::min(position, WriteAt(i).position);
+    }
+    return position;
+}
+
+uint32_t PlaybackClock::TimestampAt(int64_t time_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sample_rate_ <= 0 || mark_count_ == 0) {
+        return 0;
+    }
+    int64_t position = PositionAt(time_us);
+    if (position < 0) {
+        return 0;
+    }
+    size_t i = mark_count_;
+    while (i > 0 && MarkAt(i - 1).sample > position) {
+        i--;
+    }
+    if (i == 0) {
+        return 0;
+    }
+    const Mark& mark = MarkAt(i - 1);
+    if (mark.timestamp_ms == 0) {
+        return 0;
+    }
+    /* A mark lasts until the next one, the output task marks every frame */
+    return mark.timestamp_ms + (uint32_t)((position - mark.sample) * 1000 / sample_rate_);
+}
@@ -0,0 +1,76 @@
+#ifndef PLAYBACK_CLOCK_H
+#define PLAYBACK_CLOCK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * Tracks which downlink sample is audible at a given time, for server AEC.
+ *
+ * The output task reports every write to the codec. Playout runs at the sample rate while the DMA
+ * holds data and stalls when it runs dry. A write that returns has left at most the DMA buffer
+ * queued, so each write pulls the estimate forward to (written - buffer). A write that blocked
+ * returned as soon as a descriptor was free, so exactly the buffer is queued and the estimate is
+ * set there, in either direction. Between writes the position is interpolated from the recorded
+ * writes. After the DMA ran dry, new samples wait for the next descriptor, so the estimate assumes
+ * a full descriptor of delay and the first write that blocks corrects it. While the DMA plays
+ * silence, nothing is audible and no timestamp is returned.
+ *
+ * Each voice frame marks the sample it starts at with its server timestamp. TimestampAt() maps the
+ * playout position at a past time back to the server timeline, in milliseconds with sample
+ * resolution. The error is bounded by one DMA descriptor plus the scheduling delay of the write
+ * that returned.
+ *
+ * The output task calls Reset(), MarkTimestamp() and OnWritten(). TimestampAt() may be called from any task.
+ */
+class PlaybackClock {
+public:
+    /// @brief Set the output rate and the DMA ring and descriptor lengths, forgets the history
+    void Configure(int sample_rate, size_t buffer_samples, size_t descriptor_samples);
+    /// @brief The output was flushed, nothing is queued any more
+    void Reset(int64_t now_us);
+    /// @brief The next written sample starts a voice frame with this server timestamp, 0 for none
+    void MarkTimestamp(uint32_t timestamp_ms);
+    /// @brief `samples` were handed to the codec, the write started at `start_us` and returned at `now_us`
+    void OnWritten(size_t samples, int64_t start_us, int64_t now_us);
+    /// @brief The server timestamp that was audible at `time_us`, 0 if no voice frame was playing
+    uint32_t TimestampAt(int64_t time_us);
+
+private:
+    /* About a second of history at 10 ms writes and 60 ms frames */
+    static constexpr size_t kMaxWrites = 64;
+    static constexpr size_t kMaxMarks = 16;
+    /* A write into free descriptors is a copy, one that took longer waited for the DMA */
+    static constexpr int64_t kBlockedUs = 1000;
+
+    struct Write {
+        int64_t time_us;
+        int64_t position;   // Playout position estimated when the write returned
+        int64_t start_us;   // Playout runs from `position` at this time, later than time_us after a stall
+        int64_t written;    // Samples written so far, the DMA runs dry there
+    };
+    struct Mark {
+        int64_t sample;
+        uint32_t timestamp_ms;
+    };
+
+    std::mutex mutex_;
+    int sample_rate_ = 0;
+    int64_t buffer_samples_ = 0;
+    int64_t descriptor_us_ = 0;
+    int64_t written_ = 0;
+    Write writes_[kMaxWrites];
+    size_t write_count_ = 0;
+    size_t write_head_ = 0;   // Index of the oldest write
+    Mark marks_[kMaxMarks];
+    size_t mark_count_ = 0;
+    size_t mark_head_ = 0;
+
+    int64_t PositionAt(int64_t time_us) const;
+    void AddWrite(int64_t time_us, int64_t position, int64_t start_us);
+    const Write& WriteAt(size_t i) const { return writes_[(write_head_ + i) % kMaxWrites]; }
+    const Mark& MarkAt(size_t i) const { return marks_[(mark_head_ + i) % kMaxMarks]; }
+};
+
+#endif // PLAYBACK_CLOCK_H
@@ -14,9 +14,6 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
 
-    // Pre-allocate output buffer capacity
-    output_buffer_.reserve(frame_samples_);
-
     int ref_num = codec_->input_reference() ? 1 : 0;
 
     std::string input_format;
@@ -66,6 +63,10 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
 
     afe_iface_ = esp_afe_handle_from_config(afe_config);
     afe_data_ = afe_iface_->create_from_config(afe_config);
+
+    // Room for a feed chunk plus what arrives while it fills, and for a frame plus one fetch
+    input_buffer_.Reserve(afe_iface_->get_feed_chunksize(afe_data_) * codec_->input_channels() * 2);
+    output_buffer_.Reserve(frame_samples_ + afe_iface_->get_fetch_chunksize(afe_data_));
     
     xTaskCreate([](void* arg) {
         auto this_ = (AfeAudioProcessor*)arg;
@@ -74,6 +75,10 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
     }, "audio_communication", 4096, this, 3, NULL);
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 AfeAudioProcessor::~AfeAudioProcessor() {
     if (afe_data_ != nullptr) {
         afe_iface_->destroy(afe_data_);
@@ -88,7 +93,7 @@ size_t AfeAudioProcessor::GetFeedSize() {
     return afe_iface_->get_feed_chunksize(afe_data_);
 }
 
-void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
+void AfeAudioProcessor::Feed(const int16_t* data, size_t samples) {
     if (afe_data_ == nullptr) {
         return;
     }
@@ -98,11 +103,11 @@ void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
     if (!IsRunning()) {
         return;
     }
-    input_buffer_.insert(input_buffer_.end(), data.begin(), data.end());
+    input_buffer_.Append(data, samples);
     size_t chunk_size = afe_iface_->get_feed_chunksize(afe_data_) * codec_->input_channels();
-    while (input_buffer_.size() >= chunk_size) {
-        afe_iface_->feed(afe_data_, input_buffer_.data());
-        input_buffer_.erase(input_buffer_.begin(), input_buffer_.begin() + chunk_size);
+    while (auto chunk = input_buffer_.Peek(chunk_size)) {
+        afe_iface_->feed(afe_data_, chunk);
+        input_buffer_.Consume(chunk_size);
     }
 }
 
@@ -117,14 +122,14 @@ void AfeAudioProcessor::Stop() {
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
-    input_buffer_.clear();
+    input_buffer_.Clear();
 }
 
 bool AfeAudioProcessor::IsRunning() {
     return xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING;
 }
 
-void AfeAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+void AfeAudioProcessor::OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) {
     output_callback_ = callback;
 }
 
@@ -167,20 +172,13 @@ void AfeAudioProcessor::AudioProcessorTask() {
             size_t samples = res->data_size / sizeof(int16_t);
             
             // Add data to buffer
-            output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
+            output_buffer_.Append(res->data, samples);
             
             // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            size_t frame_samples = frame_samples_;
+            while (auto frame = output_buffer_.Peek(frame_samples)) {
+                output_callback_(frame, frame_samples);
+                output_buffer_.Consume(frame_samples);
             }
         }
     }
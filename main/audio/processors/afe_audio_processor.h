@@ -10,9 +10,11 @@
 #include <vector>
 #include <functional>
 #include <mutex>
+#include <atomic>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "frame_assembler.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -20,11 +22,12 @@ public:
     ~AfeAudioProcessor();
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
-    void Feed(std::vector<int16_t>&& data) override;
+    void SetFrameDuration(int frame_duration_ms) override;
+    void Feed(const int16_t* data, size_t samples) override;
     void Start() override;
     void Stop() override;
     bool IsRunning() override;
-    void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) override;
+    void OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) override;
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
     void EnableDeviceAec(bool enable) override;
@@ -33,14 +36,14 @@ private:
     EventGroupHandle_t event_group_ = nullptr;
     const esp_afe_sr_iface_t* afe_iface_ = nullptr;
     esp_afe_sr_data_t* afe_data_ = nullptr;
-    std::function<void(std::vector<int16_t>&& data)> output_callback_;
+    std::function<void(const int16_t* data, size_t samples)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<int> frame_samples_{0};
     bool is_speaking_ = false;
-    std::vector<int16_t> input_buffer_;
+    FrameAssembler<int16_t> input_buffer_;
     std::mutex input_buffer_mutex_;
-    std::vector<int16_t> output_buffer_;
+    FrameAssembler<int16_t> output_buffer_;
 
     void AudioProcessorTask();
 };
@@ -1,4 +1,5 @@
 #include "no_audio_processor.h"
+#include "pcm_kernels.h"
 #include <esp_log.h>
 
 #define TAG "NoAudioProcessor"
@@ -6,26 +7,38 @@
 void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
+    output_buffer_.Reserve(frame_samples_ * 2);
 }
 
-void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
+void NoAudioProcessor::Feed(const int16_t* data, size_t samples) {
     if (!is_running_ || !output_callback_) {
         return;
     }
 
+    /* Output whole frames, the encoder only takes frames of the negotiated duration */
+    size_t frame_samples = frame_samples_;
     if (codec_->input_channels() == 2) {
         // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
-        }
-        output_callback_(std::move(mono_data));
+        samples /= 2;
+        PcmKernels::ExtractChannel(data, output_buffer_.Extend(samples), samples, 2, 0);
+    } else if (output_buffer_.empty() && samples == frame_samples) {
+        output_callback_(data, samples);
+        return;
     } else {
-        output_callback_(std::move(data));
+        output_buffer_.Append(data, samples);
+    }
+    while (auto frame = output_buffer_.Peek(frame_samples)) {
+        output_callback_(frame, frame_samples);
+        output_buffer_.Consume(frame_samples);
     }
 }
 
 void NoAudioProcessor::Start() {
+    output_buffer_.Clear();
     is_running_ = true;
 }
 
@@ -37,7 +50,7 @@ bool NoAudioProcessor::IsRunning() {
     return is_running_;
 }
 
-void NoAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+void NoAudioProcessor::OnOutput(std::function<void(const int16_t* data, size_t samples)> callback) {
     output_callback_ = callback;
 }
 
@@ -0,0 +1,108 @@
+#include "sound_cache.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "SoundCache"
+
+/* The fill grows by doubling from about a quarter second at 16kHz */
+#define SOUND_CACHE_MIN_FILL_SAMPLES 4096
+
+SoundCache::Entry::~Entry() {
+    if (pcm != nullptr) {
+        heap_caps_free(pcm);
+    }
+}
+
+SoundCache::SoundCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {
+}
+
+std::shared_ptr<const SoundCache::Entry> SoundCache::Find(const void* key) {
+    if (!enabled()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(entries_.begin(), entries_.end(), [key](const auto& entry) { return entry->key == key; });
+    if (it == entries_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    entries_.splice(entries_.begin(), entries_, it);
+    return entries_.front();
+}
+
+void SoundCache::BeginFill(const void* key) {
+    filling_.reset();
+    if (!enabled()) {
+        return;
+    }
+    {
+        /* The same sound may have been queued twice before its first play finished */
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : entries_) {
+            if (entry->key == key) {
+                return;
+            }
+        }
+    }
+    filling_ = std::make_unique<Entry>();
+    filling_->key = key;
+}
+
+void SoundCache::AppendFill(const int16_t* pcm, size_t samples) {
+    if (filling_ == nullptr) {
+        return;
+    }
+    size_t needed = filling_->samples + samples;
+    if (needed * sizeof(int16_t) > budget_bytes_) {
+        ESP_LOGW(TAG, "Sound %p is larger than the cache, not cached", filling_->key);
+        filling_.reset();
+        return;
+    }
+    if (needed > filling_->capacity) {
+        size_t capacity = std::max<size_t>({needed, filling_->capacity * 2, SOUND_CACHE_MIN_FILL_SAMPLES});
+        capacity = std::min(capacity, budget_bytes_ / sizeof(int16_t));
+        auto grown = (int16_t*)heap_caps_realloc(filling_->pcm, capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (grown == nullptr) {
+            ESP_LOGW(TAG, "Out of PSRAM, sound %p not cached", filling_->key);
+            filling_.reset();
+            return;
+        }
+        filling_->pcm = grown;
+        filling_->capacity = capacity;
+    }
+    memcpy(filling_->pcm + filling_->samples, pcm, samples * sizeof(int16_t));
+    filling_->samples = needed;
+}
+
+void SoundCache::CommitFill() {
+    if (filling_ == nullptr || filling_->samples == 0) {
+        filling_.reset();
+        return;
+    }
+    /* Give the slack of the last doubling back */
+    auto shrunk = (int16_t*)heap_caps_realloc(filling_->pcm, filling_->samples * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (shrunk != nullptr) {
+        filling_->pcm = shrunk;
+        filling_->capacity = filling_->samples;
+    }
+    size_t bytes = filling_->capacity * sizeof(int16_t);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t used = used_bytes_;
+    while (!entries_.empty() && used + bytes > budget_bytes_) {
+        used -= entries_.back()->capacity * sizeof(int16_t);
+        entries_.pop_back();
+    }
+    entries_.emplace_front(std::move(filling_));
+    used_bytes_ = used + bytes;
+    ESP_LOGI(TAG, "Cached sound %p, %zu samples, %zu/%zu bytes used", entries_.front()->key,
+             entries_.front()->samples, used_bytes_.load(), budget_bytes_);
+}
+
+void SoundCache::AbortFill() {
+    filling_.reset();
+}
@@ -0,0 +1,66 @@
+#ifndef SOUND_CACHE_H
+#define SOUND_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+
+/*
+ * Decoded PCM of the system sounds, kept in PSRAM at the codec output rate.
+ *
+ * Sounds are keyed by the address of their Ogg data, which is embedded in the firmware and never
+ * moves. A sound is filled while it is decoded for the first time and inserted once its last frame
+ * is in. When the budget is exceeded the least recently played sounds are evicted. A sound that is
+ * larger than the whole budget is not cached.
+ *
+ * Find() may be called from any task. The fill is driven by the decoder task only.
+ */
+class SoundCache {
+public:
+    struct Entry {
+        const void* key = nullptr;
+        int16_t* pcm = nullptr;
+        size_t samples = 0;
+        size_t capacity = 0;
+
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry();
+    };
+
+    explicit SoundCache(size_t budget_bytes);
+
+    bool enabled() const { return budget_bytes_ > 0; }
+
+    /// @brief Look a sound up and mark it as the most recently played, counts a hit or a miss
+    std::shared_ptr<const Entry> Find(const void* key);
+
+    /// @brief Start filling a sound, drops an unfinished fill
+    void BeginFill(const void* key);
+    /// @brief Append decoded PCM, the fill is dropped if it outgrows the budget or PSRAM runs out
+    void AppendFill(const int16_t* pcm, size_t samples);
+    /// @brief Insert the filled sound, evicting the least recently played ones
+    void CommitFill();
+    void AbortFill();
+
+    uint32_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint32_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    size_t used_bytes() const { return used_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    const size_t budget_bytes_;
+    std::mutex mutex_;
+    // Most recently played first
+    std::list<std::shared_ptr<Entry>> entries_;
+    std::atomic<size_t> used_bytes_{0};
+    std::atomic<uint32_t> hits_{0};
+    std::atomic<uint32_t> misses_{0};
+    // Owned by the decoder task
+    std::unique_ptr<Entry> filling_;
+};
+
+#endif // SOUND_CACHE_H
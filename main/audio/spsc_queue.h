@@ -0,0 +1,107 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/*
+ * Bounded single-producer / single-consumer ring queue.
+ *
+ * Push() may only be called from one producer at a time and Pop() from one consumer at a time.
+ * The two sides never block each other: the write and read positions are free running counters
+ * published with release/acquire ordering.
+ *
+ * Flush() may be called from any task. It marks everything pushed so far as discarded; the
+ * consumer destroys the discarded items on its next Pop() or Reclaim(), so a flush never races
+ * with a pop that is in progress.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : capacity_(capacity), slots_(std::make_unique<T[]>(capacity)) {
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// @brief Push an item, the item is left untouched if the queue is full
+    /// @return false if the queue is full
+    bool Push(T&& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        slots_[head % capacity_] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Pop the oldest item that has not been flushed
+    /// @return false if the queue is empty
+    bool Pop(T& item) {
+        Reclaim();
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[tail % capacity_]);
+        slots_[tail % capacity_] = T();
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Consumer side only: hand the flushed items to `release` and free their slots
+    /// @return the number of items released
+    template <typename Release>
+    size_t Reclaim(Release&& release) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t mark = flush_mark_.load(std::memory_order_acquire);
+        if (mark <= tail) {
+            return 0;
+        }
+        for (size_t i = tail; i < mark; i++) {
+            release(std::move(slots_[i % capacity_]));
+            slots_[i % capacity_] = T();
+        }
+        tail_.store(mark, std::memory_order_release);
+        return mark - tail;
+    }
+    size_t Reclaim() {
+        return Reclaim([](T&&) {});
+    }
+
+    /// @brief Discard every item pushed before this call
+    void Flush() {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t mark = flush_mark_.load(std::memory_order_relaxed);
+        while (mark < head && !flush_mark_.compare_exchange_weak(mark, head, std::memory_order_release,
+                                                                 std::memory_order_relaxed)) {
+        }
+    }
+
+    /// @brief Number of items that will still be returned by Pop()
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t mark = flush_mark_.load(std::memory_order_acquire);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t begin = mark > tail ? mark : tail;
+        return head > begin ? head - begin : 0;
+    }
+    bool empty() const { return size() == 0; }
+    /// @brief True if Push() would fail, flushed items occupy slots until the consumer drops them
+    bool full() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire) >= capacity_;
+    }
+    size_t capacity() const { return capacity_; }
+
+private:
+    const size_t capacity_;
+    std::unique_ptr<T[]> slots_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> flush_mark_{0};
+};
+
+#endif // SPSC_QUEUE_H
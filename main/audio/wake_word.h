@@ -13,7 +13,8 @@ public:
     virtual ~WakeWord() = default;
     
     virtual bool Initialize(AudioCodec* codec, srmodel_list_t* models_list) = 0;
-    virtual void Feed(const std::vector<int16_t>& data) = 0;
+    /// @brief Microphone samples, interleaved when the codec has more than one input channel
+    virtual void Feed(const int16_t* data, size_t samples) = 0;
     virtual void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) = 0;
     virtual void Start() = 0;
     virtual void Stop() = 0;
@@ -15,7 +15,9 @@
 #include <atomic>
 
 #include "audio_codec.h"
+#include "frame_assembler.h"
 #include "wake_word.h"
+#include "wake_word_preroll.h"
 
 class CustomWakeWord : public WakeWord {
 public:
@@ -23,7 +25,7 @@ public:
     ~CustomWakeWord();
 
     bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
-    void Feed(const std::vector<int16_t>& data);
+    void Feed(const int16_t* data, size_t samples);
     void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback);
     void Start();
     void Stop();
@@ -53,18 +55,12 @@ private:
     AudioCodec* codec_ = nullptr;
     std::string last_detected_wake_word_;
     std::atomic<bool> running_ = false;
-    std::vector<int16_t> input_buffer_;
+    FrameAssembler<int16_t> input_buffer_;
     std::mutex input_buffer_mutex_;
 
-    TaskHandle_t wake_word_encode_task_ = nullptr;
-    StaticTask_t* wake_word_encode_task_buffer_ = nullptr;
-    StackType_t* wake_word_encode_task_stack_ = nullptr;
-    std::deque<std::vector<int16_t>> wake_word_pcm_;
-    std::deque<std::vector<uint8_t>> wake_word_opus_;
-    std::mutex wake_word_mutex_;
-    std::condition_variable wake_word_cv_;
+    WakeWordPreroll preroll_;
 
-    void StoreWakeWordData(const std::vector<int16_t>& data);
+    void StoreWakeWordData(const int16_t* data, size_t size);
     void ParseWakenetModelConfig();
 };
 
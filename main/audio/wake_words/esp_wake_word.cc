@@ -1,4 +1,5 @@
 #include "esp_wake_word.h"
+#include "pcm_kernels.h"
 #include <esp_log.h>
 
 
@@ -40,6 +41,7 @@ bool EspWakeWord::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
     int frequency = wakenet_iface_->get_samp_rate(wakenet_data_);
     int audio_chunksize = wakenet_iface_->get_samp_chunksize(wakenet_data_);
     ESP_LOGI(TAG, "Wake word(%s),freq: %d, chunksize: %d", model_name, frequency, audio_chunksize);
+    input_buffer_.Reserve(audio_chunksize * 2);
 
     return true;
 }
@@ -56,10 +58,10 @@ void EspWakeWord::Stop() {
     running_ = false;
 
     std::lock_guard<std::mutex> lock(input_buffer_mutex_);
-    input_buffer_.clear();
+    input_buffer_.Clear();
 }
 
-void EspWakeWord::Feed(const std::vector<int16_t>& data) {
+void EspWakeWord::Feed(const int16_t* data, size_t samples) {
     if (wakenet_data_ == nullptr) {
         return;
     }
@@ -71,27 +73,25 @@ void EspWakeWord::Feed(const std::vector<int16_t>& data) {
     }
 
     if (codec_->input_channels() == 2) {
-        for (size_t i = 0; i < data.size(); i += 2) {
-            input_buffer_.push_back(data[i]);
-        }
+        PcmKernels::ExtractChannel(data, input_buffer_.Extend(samples / 2), samples / 2, 2, 0);
     } else {
-        input_buffer_.insert(input_buffer_.end(), data.begin(), data.end());
+        input_buffer_.Append(data, samples);
     }
 
     int chunksize = wakenet_iface_->get_samp_chunksize(wakenet_data_);
-    while (input_buffer_.size() >= chunksize) {
-        int res = wakenet_iface_->detect(wakenet_data_, input_buffer_.data());
+    while (auto chunk = input_buffer_.Peek(chunksize)) {
+        int res = wakenet_iface_->detect(wakenet_data_, chunk);
         if (res > 0) {
             last_detected_wake_word_ = wakenet_iface_->get_word_name(wakenet_data_, res);
             running_ = false;
-            input_buffer_.clear();
+            input_buffer_.Clear();
 
             if (wake_word_detected_callback_) {
                 wake_word_detected_callback_(last_detected_wake_word_);
             }
             break;
         }
-        input_buffer_.erase(input_buffer_.begin(), input_buffer_.begin() + chunksize);
+        input_buffer_.Consume(chunksize);
     }
 }
 
@@ -12,6 +12,7 @@
 #include <mutex>
 
 #include "audio_codec.h"
+#include "frame_assembler.h"
 #include "wake_word.h"
 
 class EspWakeWord : public WakeWord {
@@ -20,7 +21,7 @@ public:
     ~EspWakeWord();
 
     bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
-    void Feed(const std::vector<int16_t>& data);
+    void Feed(const int16_t* data, size_t samples);
     void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback);
     void Start();
     void Stop();
@@ -38,7 +39,7 @@ private:
 
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
     std::string last_detected_wake_word_;
-    std::vector<int16_t> input_buffer_;
+    FrameAssembler<int16_t> input_buffer_;
     std::mutex input_buffer_mutex_;
 };
 
@@ -0,0 +1,216 @@
+#include "wake_word_preroll.h"
+#include "audio_service.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "WakeWordPreroll"
+
+#define WAKE_WORD_PREROLL_TASK_STACK_SIZE (4096 * 7)
+/* Below the detection, the encoder only has to keep up on average */
+#define WAKE_WORD_PREROLL_TASK_PRIORITY 1
+
+#ifdef CONFIG_SEND_WAKE_WORD_DATA
+#define WAKE_WORD_PREROLL_ENABLED 1
+#else
+#define WAKE_WORD_PREROLL_ENABLED 0
+#endif
+
+WakeWordPreroll::WakeWordPreroll() {
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+    if (pcm_ != nullptr) {
+        heap_caps_free(pcm_);
+    }
+    if (encoder_ != nullptr) {
+        esp_opus_enc_close(encoder_);
+    }
+}
+
+void WakeWordPreroll::Reset() {
+    if (!WAKE_WORD_PREROLL_ENABLED) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (encode_task_ == nullptr) {
+        // Without an encoder nothing is buffered, and a capture ends right away
+        esp_opus_enc_config_t opus_enc_cfg = AS_OPUS_ENC_CONFIG(OPUS_FRAME_DURATION_MS);
+        auto ret = esp_opus_enc_open(&opus_enc_cfg, sizeof(esp_opus_enc_config_t), &encoder_);
+        if (encoder_ == nullptr) {
+            ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", ret);
+            return;
+        }
+        int frame_size = 0;
+        esp_opus_enc_get_frame_size(encoder_, &frame_size, &outbuf_size_);
+        frame_size_ = frame_size / sizeof(int16_t);
+
+        pcm_capacity_ = std::max<size_t>(16000 / 1000 * WAKE_WORD_PREROLL_PCM_MS, frame_size_ * 2);
+        pcm_ = (int16_t*)heap_caps_malloc(pcm_capacity_ * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+        if (pcm_ == nullptr) {
+            pcm_ = (int16_t*)heap_caps_malloc(pcm_capacity_ * sizeof(int16_t), MALLOC_CAP_8BIT);
+        }
+        assert(pcm_ != nullptr);
+        packets_.resize(WAKE_WORD_PREROLL_DURATION_MS / OPUS_FRAME_DURATION_MS);
+
+        encode_task_stack_ = (StackType_t*)heap_caps_malloc(WAKE_WORD_PREROLL_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        assert(encode_task_stack_ != nullptr);
+        encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_buffer_ != nullptr);
+        encode_task_ = xTaskCreateStatic([](void* arg) {
+            auto this_ = (WakeWordPreroll*)arg;
+            this_->EncodeTask();
+            vTaskDelete(NULL);
+        }, "wake_word_preroll", WAKE_WORD_PREROLL_TASK_STACK_SIZE, this, WAKE_WORD_PREROLL_TASK_PRIORITY,
+            encode_task_stack_, encode_task_buffer_);
+    }
+
+    pcm_read_ = 0;
+    pcm_count_ = 0;
+    overrun_samples_ = 0;
+    packet_head_ = 0;
+    packet_count_ = 0;
+    frozen_ = false;
+    generation_++;
+    // A capture that is still being read gets its end now, the frames after it are gone
+    if (capturing_) {
+        FinishCapture();
+    }
+}
+
+void WakeWordPreroll::Feed(const int16_t* data, size_t samples) {
+    if (!WAKE_WORD_PREROLL_ENABLED) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pcm_ == nullptr || frozen_) {
+        return;
+    }
+    // The encoder fell behind, the oldest audio is overwritten
+    if (samples > pcm_capacity_) {
+        overrun_samples_ += samples - pcm_capacity_;
+        data += samples - pcm_capacity_;
+        samples = pcm_capacity_;
+    }
+    if (pcm_count_ + samples > pcm_capacity_) {
+        size_t drop = pcm_count_ + samples - pcm_capacity_;
+        pcm_read_ = (pcm_read_ + drop) % pcm_capacity_;
+        pcm_count_ -= drop;
+        overrun_samples_ += drop;
+    }
+    size_t write = (pcm_read_ + pcm_count_) % pcm_capacity_;
+    size_t first = std::min(samples, pcm_capacity_ - write);
+    memcpy(pcm_ + write, data, first * sizeof(int16_t));
+    memcpy(pcm_, data + first, (samples - first) * sizeof(int16_t));
+    pcm_count_ += samples;
+    if (pcm_count_ >= frame_size_) {
+        cv_.notify_all();
+    }
+}
+
+void WakeWordPreroll::Capture() {
+    if (!WAKE_WORD_PREROLL_ENABLED) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    captured_.clear();
+    for (size_t i = 0; i < packet_count_; i++) {
+        captured_.push_back(std::move(packets_[(packet_head_ + i) % packets_.size()]));
+    }
+    packet_head_ = 0;
+    packet_count_ = 0;
+    frozen_ = true;
+    capturing_ = true;
+    if (overrun_samples_ > 0) {
+        ESP_LOGW(TAG, "Encoder fell behind, %u ms of the pre-roll lost", (unsigned)(overrun_samples_ / 16));
+    }
+    ESP_LOGI(TAG, "Captured %u packets, %u ms still to encode", (unsigned)captured_.size(),
+        (unsigned)(pcm_count_ / 16));
+    if (!encoding_ && (encoder_ == nullptr || pcm_count_ < frame_size_)) {
+        FinishCapture();
+    }
+    cv_.notify_all();
+}
+
+void WakeWordPreroll::FinishCapture() {
+    captured_.push_back(std::vector<uint8_t>());
+    capturing_ = false;
+    cv_.notify_all();
+}
+
+bool WakeWordPreroll::Pop(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+        return !captured_.empty();
+    });
+    opus.swap(captured_.front());
+    captured_.pop_front();
+    return !opus.empty();
+}
+
+void WakeWordPreroll::EncodeTask() {
+    std::vector<int16_t> frame(frame_size_);
+    std::vector<uint8_t> opus(outbuf_size_);
+    while (true) {
+        uint32_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() {
+                return pcm_count_ >= frame_size_;
+            });
+            size_t first = std::min(frame_size_, pcm_capacity_ - pcm_read_);
+            memcpy(frame.data(), pcm_ + pcm_read_, first * sizeof(int16_t));
+            memcpy(frame.data() + first, pcm_, (frame_size_ - first) * sizeof(int16_t));
+            pcm_read_ = (pcm_read_ + frame_size_) % pcm_capacity_;
+            pcm_count_ -= frame_size_;
+            generation = generation_;
+            encoding_ = true;
+        }
+
+        esp_audio_enc_in_frame_t in = {};
+        esp_audio_enc_out_frame_t out = {};
+        in.buffer = (uint8_t*)frame.data();
+        in.len = (uint32_t)(frame_size_ * sizeof(int16_t));
+        out.buffer = opus.data();
+        out.len = (uint32_t)opus.size();
+        out.encoded_bytes = 0;
+        auto ret = esp_opus_enc_process(encoder_, &in, &out);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        encoding_ = false;
+        if (generation == generation_) {
+            if (ret != ESP_AUDIO_ERR_OK) {
+                ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+            } else if (frozen_) {
+                captured_.emplace_back(opus.data(), opus.data() + out.encoded_bytes);
+                cv_.notify_all();
+            } else {
+                // Reuse the slot of the oldest packet once the ring is full
+                auto& slot = packets_[(packet_head_ + packet_count_) % packets_.size()];
+                slot.assign(opus.data(), opus.data() + out.encoded_bytes);
+                if (packet_count_ < packets_.size()) {
+                    packet_count_++;
+                } else {
+                    packet_head_ = (packet_head_ + 1) % packets_.size();
+                }
+            }
+        }
+        if (capturing_ && pcm_count_ < frame_size_) {
+            FinishCapture();
+        }
+    }
+}
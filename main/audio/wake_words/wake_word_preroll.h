@@ -0,0 +1,74 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/* Audio sent ahead of the wake word, about 2 seconds */
+#define WAKE_WORD_PREROLL_DURATION_MS 2000
+/* PCM waiting for the encoder, the slack it gets while the detection keeps the core busy */
+#define WAKE_WORD_PREROLL_PCM_MS 480
+
+/*
+ * The audio around a wake word, Opus-encoded while the wake word is still being listened for.
+ *
+ * The detection feeds 16 kHz mono PCM into a fixed ring. A low-priority task encodes it into a fixed
+ * ring of the last WAKE_WORD_PREROLL_DURATION_MS of Opus packets, so the packets are ready as soon as
+ * the wake word is detected. Capture() publishes them, and the frames still waiting for the encoder
+ * follow. Pop() then returns them in order and false after the last one.
+ *
+ * Does nothing unless CONFIG_SEND_WAKE_WORD_DATA is set, nobody would read the packets.
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll();
+    ~WakeWordPreroll();
+
+    /// @brief Drop the audio buffered so far, called when the detection (re)starts
+    void Reset();
+    /// @brief Called by the detection with the audio it just processed
+    void Feed(const int16_t* data, size_t samples);
+    /// @brief Publish the buffered audio, called once the wake word is detected
+    void Capture();
+    /// @brief Blocks until the next packet is encoded, false after the last one
+    bool Pop(std::vector<uint8_t>& opus);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // PCM waiting for the encoder
+    int16_t* pcm_ = nullptr;
+    size_t pcm_capacity_ = 0;
+    size_t pcm_read_ = 0;
+    size_t pcm_count_ = 0;
+    size_t overrun_samples_ = 0;
+    // The last WAKE_WORD_PREROLL_DURATION_MS of Opus packets, each slot keeps its capacity
+    std::vector<std::vector<uint8_t>> packets_;
+    size_t packet_head_ = 0;
+    size_t packet_count_ = 0;
+    // Published by Capture(), an empty packet marks the end
+    std::deque<std::vector<uint8_t>> captured_;
+    bool frozen_ = false;       // Captured, the feed is ignored until Reset()
+    bool capturing_ = false;    // Captured, the end marker is still to come
+    bool encoding_ = false;     // A frame is out of the PCM ring and being encoded
+    uint32_t generation_ = 0;   // Bumped by Reset(), a frame encoded before it is dropped
+
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+    void* encoder_ = nullptr;
+    size_t frame_size_ = 0;
+    int outbuf_size_ = 0;
+
+    void EncodeTask();
+    void FinishCapture();
+};
+
+#endif // WAKE_WORD_PREROLL_H
@@ -2,6 +2,7 @@
 
 #include "audio_codec.h"
 #include "display.h"
+#include "application.h"
 
 #include <esp_log.h>
 #include <esp_timer.h>
@@ -217,6 +218,7 @@ std::string Ml307Board::GetDeviceStatusJson() {
         cJSON_AddNumberToObject(audio_speaker, "volume", audio_codec->output_volume());
     }
     cJSON_AddItemToObject(root, "audio_speaker", audio_speaker);
+    cJSON_AddItemToObject(root, "audio_latency", Application::GetInstance().GetAudioService().GetLatencyTracer().GetSummaryJson());
 
     // Screen brightness
     auto backlight = board.GetBacklight();
@@ -217,6 +217,7 @@ std::string Nt26Board::GetDeviceStatusJson() {
         cJSON_AddNumberToObject(audio_speaker, "volume", audio_codec->output_volume());
     }
     cJSON_AddItemToObject(root, "audio_speaker", audio_speaker);
+    cJSON_AddItemToObject(root, "audio_latency", Application::GetInstance().GetAudioService().GetLatencyTracer().GetSummaryJson());
 
     // Screen
     auto backlight = board.GetBacklight();
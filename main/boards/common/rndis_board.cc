@@ -202,6 +202,7 @@ std::string RndisBoard::GetDeviceStatusJson() {
         cJSON_AddNumberToObject(audio_speaker, "volume", codec->output_volume());
     }
     cJSON_AddItemToObject(root, "audio_speaker", audio_speaker);
+    cJSON_AddItemToObject(root, "audio_latency", Application::GetInstance().GetAudioService().GetLatencyTracer().GetSummaryJson());
 
     // Screen
     auto screen = cJSON_CreateObject();
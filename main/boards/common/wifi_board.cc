@@ -309,6 +309,7 @@ std::string WifiBoard::GetDeviceStatusJson() {
         cJSON_AddNumberToObject(audio_speaker, "volume", codec->output_volume());
     }
     cJSON_AddItemToObject(root, "audio_speaker", audio_speaker);
+    cJSON_AddItemToObject(root, "audio_latency", Application::GetInstance().GetAudioService().GetLatencyTracer().GetSummaryJson());
 
     // Screen
     auto screen = cJSON_CreateObject();
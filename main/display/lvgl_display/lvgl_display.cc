@@ -9,6 +9,7 @@
 #include "board.h"
 #include "application.h"
 #include "audio_codec.h"
+#include "pcm_kernels.h"
 #include "settings.h"
 #include "assets/lang_config.h"
 #include "jpg/image_to_jpeg.h"
@@ -240,10 +241,7 @@ bool LvglDisplay::SnapshotToJpeg(std::string& jpeg_data, int quality) {
 
     // swap bytes
     uint16_t* data = (uint16_t*)draw_buffer->data;
-    size_t pixel_count = draw_buffer->data_size / 2;
-    for (size_t i = 0; i < pixel_count; i++) {
-        data[i] = __builtin_bswap16(data[i]);
-    }
+    PcmKernels::SwapBytes16(data, draw_buffer->data_size / 2);
 
     // Clear output string and use callback version to avoid pre-allocating large memory blocks
     jpeg_data.clear();
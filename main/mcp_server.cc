@@ -148,6 +148,20 @@ void McpServer::AddUserOnlyTools() {
             return true;
         });
 
+    AddUserOnlyTool("self.audio.get_latency",
+        "Get the per-stage audio latency histograms, from microphone to server and from server to speaker",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [this](const PropertyList& properties) -> ReturnValue {
+            auto& tracer = Application::GetInstance().GetAudioService().GetLatencyTracer();
+            auto json = tracer.GetHistogramJson();
+            if (properties["reset"].value<bool>()) {
+                tracer.Reset();
+            }
+            return json;
+        });
+
     // Firmware upgrade
     AddUserOnlyTool("self.upgrade_firmware", "Upgrade firmware from a specific URL. This will download and install the firmware, then reboot the device.",
         PropertyList({
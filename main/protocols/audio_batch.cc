@@ -0,0 +1,80 @@
+#include "audio_batch.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+
+AudioBatch::AudioBatch() {
+    buffer_.resize(kHeaderRoom);
+}
+
+void AudioBatch::Reset() {
+    buffer_.resize(kHeaderRoom);
+    count_ = 0;
+    timestamp_ = 0;
+    frame_duration_ = 0;
+}
+
+bool AudioBatch::Add(const AudioStreamPacket& packet, size_t max_frames) {
+    if (count_ >= max_frames || count_ >= BINARY_PROTOCOL4_MAX_FRAMES || packet.payload.size() > UINT16_MAX) {
+        return false;
+    }
+    if (count_ > 0) {
+        if (packet.frame_duration != frame_duration_ || (timestamp_ == 0) != (packet.timestamp == 0)) {
+            return false;
+        }
+        /* AEC timestamps come from the playback clock and jitter by a few milliseconds */
+        int32_t drift = (int32_t)(packet.timestamp - (timestamp_ + count_ * frame_duration_));
+        if (timestamp_ != 0 && (drift > frame_duration_ / 4 || drift < -frame_duration_ / 4)) {
+            return false;
+        }
+    } else {
+        timestamp_ = packet.timestamp;
+        frame_duration_ = packet.frame_duration;
+    }
+    sizes_[count_++] = packet.payload.size();
+    buffer_.insert(buffer_.end(), packet.payload.begin(), packet.payload.end());
+    return true;
+}
+
+const uint8_t* AudioBatch::Finish(size_t& size) {
+    size_t header_size = sizeof(BinaryProtocol4) + count_ * sizeof(uint16_t);
+    auto bp4 = (BinaryProtocol4*)(buffer_.data() + kHeaderRoom - header_size);
+    bp4->type = 0;
+    bp4->frame_count = count_;
+    bp4->reserved = 0;
+    bp4->timestamp = htonl(timestamp_);
+    for (size_t i = 0; i < count_; i++) {
+        bp4->frame_sizes[i] = htons(sizes_[i]);
+    }
+    size = buffer_.size() - kHeaderRoom + header_size;
+    return (const uint8_t*)bp4;
+}
+
+bool AudioBatch::Parse(const uint8_t* data, size_t size, int frame_duration,
+    const std::function<void(size_t index, uint32_t timestamp, const uint8_t* payload, size_t payload_size)>& on_frame) {
+    if (size < sizeof(BinaryProtocol4)) {
+        return false;
+    }
+    auto bp4 = (const BinaryProtocol4*)data;
+    size_t header_size = sizeof(BinaryProtocol4) + bp4->frame_count * sizeof(uint16_t);
+    if (bp4->type != 0 || size < header_size) {
+        return false;
+    }
+    /* Check the whole table first, a malformed message is dropped as a whole */
+    size_t total = 0;
+    for (size_t i = 0; i < bp4->frame_count; i++) {
+        total += ntohs(bp4->frame_sizes[i]);
+    }
+    if (total > size - header_size) {
+        return false;
+    }
+
+    uint32_t timestamp = ntohl(bp4->timestamp);
+    const uint8_t* payload = data + header_size;
+    for (size_t i = 0; i < bp4->frame_count; i++) {
+        size_t payload_size = ntohs(bp4->frame_sizes[i]);
+        on_frame(i, timestamp != 0 ? timestamp + i * frame_duration : 0, payload, payload_size);
+        payload += payload_size;
+    }
+    return true;
+}
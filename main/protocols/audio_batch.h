@@ -0,0 +1,51 @@
+#ifndef AUDIO_BATCH_H
+#define AUDIO_BATCH_H
+
+#include "protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Collects consecutive uplink frames into one BinaryProtocol4 message, and splits received ones.
+ *
+ * A message carries a base timestamp and the size of each frame, the frames follow back to back.
+ * The timestamps of the later frames are derived from the frame duration, so a batch only takes
+ * frames that continue it: same duration and a timestamp in step with the first frame (or all 0).
+ * The frames are copied once when they are added. Room for the largest header is kept in front
+ * of them, so Finish() writes the header in place and the message is one contiguous block.
+ *
+ * Not thread-safe, the protocol holds its own lock.
+ */
+class AudioBatch {
+public:
+    AudioBatch();
+
+    /// @brief Drop the collected frames
+    void Reset();
+    /// @brief Add a copy of the frame, false if it does not continue the batch or `max_frames` are collected
+    bool Add(const AudioStreamPacket& packet, size_t max_frames);
+    /// @brief The message of the collected frames, valid until the next Add() or Reset()
+    const uint8_t* Finish(size_t& size);
+
+    size_t frame_count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    uint32_t timestamp() const { return timestamp_; }
+
+    /// @brief Call `on_frame` for each frame of a received message, false if the message is malformed
+    static bool Parse(const uint8_t* data, size_t size, int frame_duration,
+        const std::function<void(size_t index, uint32_t timestamp, const uint8_t* payload, size_t payload_size)>& on_frame);
+
+private:
+    static constexpr size_t kHeaderRoom = sizeof(BinaryProtocol4) + BINARY_PROTOCOL4_MAX_FRAMES * sizeof(uint16_t);
+
+    std::vector<uint8_t> buffer_;   // Header room, then the frames
+    uint16_t sizes_[BINARY_PROTOCOL4_MAX_FRAMES];
+    size_t count_ = 0;
+    uint32_t timestamp_ = 0;
+    int frame_duration_ = 0;
+};
+
+#endif // AUDIO_BATCH_H
@@ -163,30 +163,82 @@ bool MqttProtocol::SendText(const std::string& text) {
     return true;
 }
 
-bool MqttProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
+bool MqttProtocol::SendAudio(AudioStreamPacket& packet) {
     std::lock_guard<std::mutex> lock(channel_mutex_);
     if (udp_ == nullptr) {
         return false;
     }
 
-    std::string nonce(aes_nonce_);
-    *(uint16_t*)&nonce[2] = htons(packet->payload.size());
-    *(uint32_t*)&nonce[8] = htonl(packet->timestamp);
-    *(uint32_t*)&nonce[12] = htonl(++local_sequence_);
+    if (batch_max_frames_ > 0) {
+        if (!audio_batch_.Add(packet, batch_frames_)) {
+            if (!SendBatch() || !audio_batch_.Add(packet, batch_frames_)) {
+                return false;
+            }
+        }
+        if (audio_batch_.frame_count() >= (size_t)batch_frames_) {
+            return SendBatch();
+        }
+        return true;
+    }
+    return SendDatagram(packet.payload.data(), packet.payload.size(), packet.timestamp, 1);
+}
 
-    std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet->payload.size());
-    memcpy(encrypted.data(), nonce.data(), nonce.size());
+bool MqttProtocol::FlushAudio() {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    return SendBatch();
+}
+
+void MqttProtocol::DiscardAudio() {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    audio_batch_.Reset();
+}
+
+bool MqttProtocol::SendBatch() {
+    if (audio_batch_.empty()) {
+        return true;
+    }
+    size_t size = 0;
+    auto message = audio_batch_.Finish(size);
+    bool sent = SendDatagram(message, size, audio_batch_.timestamp(), audio_batch_.frame_count());
+    audio_batch_.Reset();
+    return sent;
+}
+
+bool MqttProtocol::SendDatagram(const uint8_t* payload, size_t size, uint32_t timestamp, size_t frames) {
+    if (udp_ == nullptr) {
+        return false;
+    }
 
-    size_t nc_off = 0;
-    uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet->payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
-        (uint8_t*)packet->payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
+    /* Each frame takes a sequence number, the nonce carries the first one */
+    uint32_t sequence = local_sequence_ + 1;
+    local_sequence_ += frames;
+    if (!cipher_.Encrypt(payload, size, timestamp, sequence, send_buffer_)) {
         ESP_LOGE(TAG, "Failed to encrypt audio data");
         return false;
     }
 
-    return udp_->Send(encrypted) > 0;
+    return udp_->Send(send_buffer_) > 0;
+}
+
+bool MqttProtocol::CheckSequence(uint32_t sequence) {
+    /* Reordered packets are kept, the jitter buffer puts them back in order and conceals the gaps */
+    uint32_t newest = sequence_window_.newest();
+    switch (sequence_window_.Check(sequence)) {
+        case SequenceWindow::kSequenceDuplicate:
+            ESP_LOGW(TAG, "Dropping duplicate audio packet: %lu", sequence);
+            return false;
+        case SequenceWindow::kSequenceTooOld:
+            ESP_LOGW(TAG, "Dropping audio packet too far behind: %lu, newest: %lu", sequence, newest);
+            return false;
+        case SequenceWindow::kSequenceGap:
+            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, newest + 1);
+            return true;
+        case SequenceWindow::kSequenceReordered:
+            ESP_LOGD(TAG, "Received reordered audio packet: %lu, newest: %lu", sequence, newest);
+            return true;
+        default:
+            return true;
+    }
 }
 
 void MqttProtocol::CloseAudioChannel(bool send_goodbye) {
@@ -196,6 +248,9 @@ void MqttProtocol::CloseAudioChannel(bool send_goodbye) {
     }
 
     ESP_LOGI(TAG, "Closing audio channel, send_goodbye: %d", send_goodbye);
+    auto statistics = sequence_window_.statistics();
+    ESP_LOGI(TAG, "UDP audio received: %lu, lost: %lu, reordered: %lu, duplicates: %lu, too old: %lu",
+        statistics.received, statistics.lost, statistics.reordered, statistics.duplicates, statistics.too_old);
 
     // Only send goodbye when client initiates the close
     // Don't send if server already sent goodbye (to avoid ping-pong)
@@ -223,8 +278,15 @@ bool MqttProtocol::OpenAudioChannel() {
     error_occurred_ = false;
     session_id_ = "";
     xEventGroupClearBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        batch_max_frames_ = 0;
+        batch_frames_ = 1;
+        audio_batch_.Reset();
+    }
 
     auto message = GetHelloMessage();
+    hello_time_ = std::chrono::steady_clock::now();
     if (!SendText(message)) {
         return false;
     }
@@ -245,8 +307,9 @@ bool MqttProtocol::OpenAudioChannel() {
          * UDP Encrypted OPUS Packet Format:
          * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
          * |payload payload_len|
+         * With protocol version 4 the payload is a BinaryProtocol4 message and the sequence is the first frame's.
          */
-        if (data.size() < sizeof(aes_nonce_)) {
+        if (data.size() < UdpAudioCipher::kNonceSize) {
             ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
             return;
         }
@@ -256,33 +319,52 @@ bool MqttProtocol::OpenAudioChannel() {
         }
         uint32_t timestamp = ntohl(*(uint32_t*)&data[8]);
         uint32_t sequence = ntohl(*(uint32_t*)&data[12]);
-        if (sequence < remote_sequence_) {
-            ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
+        size_t decrypted_size = data.size() - UdpAudioCipher::kNonceSize;
+
+        if (batch_max_frames_ > 0) {
+            /* A protocol version 4 datagram, the frames take consecutive sequence numbers from the nonce */
+            receive_buffer_.resize(decrypted_size);
+            if (!cipher_.Decrypt((const uint8_t*)data.data(), data.size(), receive_buffer_.data())) {
+                ESP_LOGE(TAG, "Failed to decrypt audio data");
+                return;
+            }
+            auto on_frame = [this, sequence](size_t index, uint32_t timestamp, const uint8_t* payload, size_t payload_size) {
+                if (!CheckSequence(sequence + index) || on_incoming_audio_ == nullptr) {
+                    return;
+                }
+                auto packet = AcquirePacket();
+                packet->sample_rate = server_sample_rate_;
+                packet->frame_duration = server_frame_duration_;
+                packet->timestamp = timestamp;
+                packet->sequence = sequence + index;
+                packet->payload.assign(payload, payload + payload_size);
+                on_incoming_audio_(std::move(packet));
+            };
+            if (!AudioBatch::Parse(receive_buffer_.data(), decrypted_size, server_frame_duration_, on_frame)) {
+                ESP_LOGE(TAG, "Invalid audio batch, size: %u", decrypted_size);
+                return;
+            }
+            last_incoming_time_ = std::chrono::steady_clock::now();
             return;
         }
-        if (sequence != remote_sequence_ + 1) {
-            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
-        }
 
-        size_t decrypted_size = data.size() - aes_nonce_.size();
-        size_t nc_off = 0;
-        uint8_t stream_block[16] = {0};
-        auto nonce = (uint8_t*)data.data();
-        auto encrypted = (uint8_t*)data.data() + aes_nonce_.size();
-        auto packet = std::make_unique<AudioStreamPacket>();
+        if (!CheckSequence(sequence)) {
+            return;
+        }
+        /* Decrypt straight into a pooled packet */
+        auto packet = AcquirePacket();
         packet->sample_rate = server_sample_rate_;
         packet->frame_duration = server_frame_duration_;
         packet->timestamp = timestamp;
+        packet->sequence = sequence;
         packet->payload.resize(decrypted_size);
-        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t*)packet->payload.data());
-        if (ret != 0) {
-            ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
+        if (!cipher_.Decrypt((const uint8_t*)data.data(), data.size(), packet->payload.data())) {
+            ESP_LOGE(TAG, "Failed to decrypt audio data");
             return;
         }
         if (on_incoming_audio_ != nullptr) {
             on_incoming_audio_(std::move(packet));
         }
-        remote_sequence_ = sequence;
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -305,12 +387,13 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+    AddBatchFeature(features);
     cJSON_AddItemToObject(root, "features", features);
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", preferred_frame_duration_);
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -332,18 +415,9 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
-    // Get sample rate from hello message
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
-    }
+    // Get sample rate and frame duration from hello message
+    ParseAudioParams(cJSON_GetObjectItem(root, "audio_params"));
+    ParseBatchParams(root);
 
     auto udp = cJSON_GetObjectItem(root, "udp");
     if (!cJSON_IsObject(udp)) {
@@ -357,11 +431,9 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     // auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     // ESP_LOGI(TAG, "UDP server: %s, port: %d, encryption: %s", udp_server_.c_str(), udp_port_, encryption);
-    aes_nonce_ = DecodeHexString(nonce);
-    mbedtls_aes_init(&aes_ctx_);
-    mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)DecodeHexString(key).c_str(), 128);
+    cipher_.SetKey(DecodeHexString(key), DecodeHexString(nonce));
     local_sequence_ = 0;
-    remote_sequence_ = 0;
+    sequence_window_.Reset();
     xEventGroupSetBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 }
 
@@ -3,10 +3,12 @@
 
 
 #include "protocol.h"
+#include "sequence_window.h"
+#include "audio_batch.h"
+#include "udp_audio_cipher.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
-#include <mbedtls/aes.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <esp_timer.h>
@@ -29,10 +31,14 @@ public:
     ~MqttProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    bool FlushAudio() override;
+    void DiscardAudio() override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel(bool send_goodbye = true) override;
     bool IsAudioChannelOpened() const override;
+    /// @brief Loss, reorder and duplicate counts of the UDP audio in the current session
+    SequenceWindow::Statistics GetUdpStatistics() const { return sequence_window_.statistics(); }
 
 private:
     // Alive flag for safe scheduled callbacks - set to false in destructor
@@ -45,15 +51,26 @@ private:
     std::mutex channel_mutex_;
     std::unique_ptr<Mqtt> mqtt_;
     std::unique_ptr<Udp> udp_;
-    mbedtls_aes_context aes_ctx_;
-    std::string aes_nonce_;
+    UdpAudioCipher cipher_;
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
-    uint32_t remote_sequence_;
+    // Nonce header plus encrypted payload of the frame being sent, keeps its capacity between frames
+    std::string send_buffer_;
+    // Uplink frames waiting for a protocol version 4 datagram, guarded by channel_mutex_
+    AudioBatch audio_batch_;
+    // Owned by the UDP receive callback, a decrypted protocol version 4 datagram
+    std::vector<uint8_t> receive_buffer_;
+    // Owned by the UDP receive callback, reset with each server hello
+    SequenceWindow sequence_window_;
     esp_timer_handle_t reconnect_timer_;
 
     bool StartMqttClient(bool report_error=false);
+    // Callers hold channel_mutex_
+    bool SendBatch();
+    bool SendDatagram(const uint8_t* payload, size_t size, uint32_t timestamp, size_t frames);
+    // Called by the UDP receive callback, false if the packet is dropped
+    bool CheckSequence(uint32_t sequence);
     void ParseServerHello(const cJSON* root);
     std::string DecodeHexString(const std::string& hex_string);
 
@@ -0,0 +1,74 @@
+#ifndef PACKET_BUFFER_H
+#define PACKET_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+ * The payload of an audio packet, with room for a protocol header kept in front of it.
+ *
+ * The payload side behaves like a std::vector<uint8_t>. Header() hands out the bytes right before
+ * the payload, so a protocol writes its header there and sends header and payload as one block
+ * without copying the payload. Packets created with enough headroom never move their payload, a
+ * packet without it is moved back once to make room.
+ *
+ * Not thread-safe, a packet has one owner at a time.
+ */
+class PacketBuffer {
+public:
+    PacketBuffer() = default;
+    PacketBuffer(const uint8_t* first, const uint8_t* last) {
+        assign(first, last);
+    }
+
+    /// @brief Keep `headroom` bytes in front of the payload, the payload is kept
+    void SetHeadroom(size_t headroom) {
+        size_t payload_size = size();
+        if (headroom > headroom_) {
+            storage_.resize(headroom + payload_size);
+            memmove(storage_.data() + headroom, storage_.data() + headroom_, payload_size);
+        } else if (headroom < headroom_) {
+            memmove(storage_.data() + headroom, storage_.data() + headroom_, payload_size);
+            storage_.resize(headroom + payload_size);
+        }
+        headroom_ = headroom;
+    }
+    size_t headroom() const { return headroom_; }
+
+    /// @brief The `size` bytes right in front of the payload, for the caller to write a header into
+    uint8_t* Header(size_t size) {
+        if (size > headroom_) {
+            SetHeadroom(size);
+        }
+        return storage_.data() + headroom_ - size;
+    }
+
+    uint8_t* data() { return storage_.data() + headroom_; }
+    const uint8_t* data() const { return storage_.data() + headroom_; }
+    size_t size() const { return storage_.size() - headroom_; }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return storage_.capacity() - headroom_; }
+
+    void resize(size_t size) { storage_.resize(headroom_ + size); }
+    void reserve(size_t capacity) { storage_.reserve(headroom_ + capacity); }
+    void clear() { storage_.resize(headroom_); }
+    void assign(const uint8_t* first, const uint8_t* last) {
+        resize(last - first);
+        memcpy(data(), first, last - first);
+    }
+
+    uint8_t& operator[](size_t i) { return data()[i]; }
+    const uint8_t& operator[](size_t i) const { return data()[i]; }
+    uint8_t* begin() { return data(); }
+    uint8_t* end() { return data() + size(); }
+    const uint8_t* begin() const { return data(); }
+    const uint8_t* end() const { return data() + size(); }
+
+private:
+    std::vector<uint8_t> storage_;   // Headroom, then the payload
+    size_t headroom_ = 0;
+};
+
+#endif // PACKET_BUFFER_H
@@ -1,6 +1,7 @@
 #include "protocol.h"
 
 #include <esp_log.h>
+#include <algorithm>
 
 #define TAG "Protocol"
 
@@ -32,6 +33,81 @@ void Protocol::OnDisconnected(std::function<void()> callback) {
     on_disconnected_ = callback;
 }
 
+void Protocol::SetFrameDuration(int frame_duration_ms) {
+    preferred_frame_duration_ = frame_duration_ms;
+    frame_duration_ = frame_duration_ms;
+}
+
+void Protocol::SetPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator) {
+    packet_allocator_ = allocator;
+}
+
+std::unique_ptr<AudioStreamPacket> Protocol::AcquirePacket() {
+    if (!packet_allocator_) {
+        return std::make_unique<AudioStreamPacket>();
+    }
+    auto packet = packet_allocator_();
+    packet->origin_time_us = 0;
+    packet->stage_time_us = 0;
+    return packet;
+}
+
+void Protocol::ParseAudioParams(const cJSON* audio_params) {
+    frame_duration_ = preferred_frame_duration_;
+    if (!cJSON_IsObject(audio_params)) {
+        return;
+    }
+    auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
+    if (cJSON_IsNumber(sample_rate)) {
+        server_sample_rate_ = sample_rate->valueint;
+    }
+    auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
+    if (cJSON_IsNumber(frame_duration)) {
+        server_frame_duration_ = frame_duration->valueint;
+    }
+    /* frame_duration is the server's downlink, the uplink only changes if the server asks for it separately */
+    auto uplink_frame_duration = cJSON_GetObjectItem(audio_params, "uplink_frame_duration");
+    if (cJSON_IsNumber(uplink_frame_duration)) {
+        int duration = uplink_frame_duration->valueint;
+        if (duration == 20 || duration == 40 || duration == 60) {
+            frame_duration_ = duration;
+        } else {
+            ESP_LOGW(TAG, "Uplink frame duration %d ms is not supported, keeping %d ms", duration, frame_duration_);
+        }
+    }
+    auto fec = cJSON_GetObjectItem(audio_params, "fec");
+    server_fec_ = cJSON_IsTrue(fec);
+}
+
+void Protocol::AddBatchFeature(cJSON* features) {
+    cJSON_AddNumberToObject(features, "batch", BINARY_PROTOCOL4_MAX_FRAMES);
+}
+
+void Protocol::ParseBatchParams(const cJSON* root) {
+    /* The hello exchange is the only round trip measured, one sample per session smoothed over the
+     * sessions. It includes the server's handling of the hello, so it is an upper bound for the link. */
+    int rtt_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hello_time_).count();
+    hello_rtt_ms_ = hello_rtt_ms_ == 0 ? rtt_ms : (hello_rtt_ms_ * 3 + rtt_ms) / 4;
+
+    batch_max_frames_ = 0;
+    batch_frames_ = 1;
+    auto version = cJSON_GetObjectItem(root, "version");
+    if (!cJSON_IsNumber(version) || version->valueint != 4) {
+        return;
+    }
+    batch_max_frames_ = BINARY_PROTOCOL4_MAX_FRAMES;
+    auto batch = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "features"), "batch");
+    if (cJSON_IsNumber(batch) && batch->valueint > 0) {
+        batch_max_frames_ = std::min(batch_max_frames_, batch->valueint);
+    }
+    /* The depth stays as it is until the next hello */
+    batch_frames_ = std::min({batch_max_frames_, 1 + hello_rtt_ms_ / AUDIO_BATCH_RTT_STEP_MS,
+        std::max(1, AUDIO_BATCH_MAX_DURATION_MS / frame_duration_)});
+    ESP_LOGI(TAG, "Protocol version 4, hello RTT %d ms, %d frames per message for this session",
+        hello_rtt_ms_, batch_frames_);
+}
+
 void Protocol::SetError(const std::string& message) {
     error_occurred_ = true;
     if (on_network_error_ != nullptr) {
@@ -49,12 +125,15 @@ void Protocol::SendAbortSpeaking(AbortReason reason) {
 }
 
 void Protocol::SendWakeWordDetected(const std::string& wake_word) {
+    FlushAudio();
     std::string json = "{\"session_id\":\"" + session_id_ + 
                       "\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"" + wake_word + "\"}";
     SendText(json);
 }
 
 void Protocol::SendStartListening(ListeningMode mode) {
+    /* Frames sent after the last turn ended belong to no turn */
+    DiscardAudio();
     std::string message = "{\"session_id\":\"" + session_id_ + "\"";
     message += ",\"type\":\"listen\",\"state\":\"start\"";
     if (mode == kListeningModeRealtime) {
@@ -69,6 +148,7 @@ void Protocol::SendStartListening(ListeningMode mode) {
 }
 
 void Protocol::SendStopListening() {
+    FlushAudio();
     std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"listen\",\"state\":\"stop\"}";
     SendText(message);
 }
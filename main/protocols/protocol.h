@@ -6,12 +6,30 @@
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <memory>
+
+#include "packet_buffer.h"
+
+// Room kept in front of outgoing payloads for the largest protocol header (BinaryProtocol2, the UDP nonce)
+#define AUDIO_PACKET_HEADROOM 16
+
+/* Protocol version 4 carries several consecutive frames per message. The depth is set once per session
+ * from the hello round trip, one frame more per AUDIO_BATCH_RTT_STEP_MS, holding back at most
+ * AUDIO_BATCH_MAX_DURATION_MS of audio. That round trip includes the server's handling of the hello,
+ * so it overstates the link on a busy server, and the depth does not follow the link during a session. */
+#define BINARY_PROTOCOL4_MAX_FRAMES 8
+#define AUDIO_BATCH_MAX_DURATION_MS 240
+#define AUDIO_BATCH_RTT_STEP_MS 150
 
 struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
-    std::vector<uint8_t> payload;
+    PacketBuffer payload;
+    uint32_t sequence = 0;  // 0 if the transport has no sequence numbers
+    // Latency tracing, esp_timer time the frame entered the pipeline and its current stage (0 if not traced)
+    int64_t origin_time_us = 0;
+    int64_t stage_time_us = 0;
 };
 
 struct BinaryProtocol2 {
@@ -30,6 +48,16 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+struct BinaryProtocol4 {
+    uint8_t type;           // Message type (0: OPUS)
+    uint8_t frame_count;    // Number of frames in the message
+    uint16_t reserved;
+    uint32_t timestamp;     // Timestamp of the first frame in milliseconds, the next ones follow every frame duration
+    uint16_t frame_sizes[]; // frame_count frame sizes, then the frames back to back
+} __attribute__((packed));
+
+static_assert(sizeof(BinaryProtocol2) <= AUDIO_PACKET_HEADROOM, "BinaryProtocol2 must fit in the packet headroom");
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -51,9 +79,24 @@ public:
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
+    inline bool server_fec() const {
+        return server_fec_;
+    }
+    // Uplink frame duration of the current session, the preferred one unless the server hello set uplink_frame_duration
+    inline int frame_duration() const {
+        return frame_duration_;
+    }
     inline const std::string& session_id() const {
         return session_id_;
     }
+    // Frames per binary audio message, 1 unless protocol version 4 was negotiated
+    inline int batch_frames() const {
+        return batch_frames_;
+    }
+    // Round trip of the hello exchanges including the server's handling, smoothed over sessions, in milliseconds
+    inline int hello_rtt_ms() const {
+        return hello_rtt_ms_;
+    }
 
     void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
     void OnIncomingJson(std::function<void(const cJSON* root)> callback);
@@ -62,12 +105,20 @@ public:
     void OnNetworkError(std::function<void(const std::string& message)> callback);
     void OnConnected(std::function<void()> callback);
     void OnDisconnected(std::function<void()> callback);
+    void SetFrameDuration(int frame_duration_ms);
+    /// @brief Where incoming audio packets come from, so their buffers can be handed back and reused
+    void SetPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator);
 
     virtual bool Start() = 0;
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel(bool send_goodbye = true) = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    /// @brief Send one frame, the protocol may write its header into the headroom of the payload
+    virtual bool SendAudio(AudioStreamPacket& packet) = 0;
+    /// @brief Send the frames collected for a batch without waiting for the batch to fill up
+    virtual bool FlushAudio() { return true; }
+    /// @brief Drop the frames collected for a batch, so the tail of an earlier turn does not lead the next one
+    virtual void DiscardAudio() {}
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -82,16 +133,31 @@ protected:
     std::function<void(const std::string& message)> on_network_error_;
     std::function<void()> on_connected_;
     std::function<void()> on_disconnected_;
+    std::function<std::unique_ptr<AudioStreamPacket>()> packet_allocator_;
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    bool server_fec_ = false;
+    int preferred_frame_duration_ = 60;
+    int frame_duration_ = 60;
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    std::chrono::time_point<std::chrono::steady_clock> hello_time_;
+    int batch_max_frames_ = 0;  // Frames the server takes per message, 0 without protocol version 4
+    int batch_frames_ = 1;     // Fixed for the session by ParseBatchParams()
+    int hello_rtt_ms_ = 0;
 
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
+    void ParseAudioParams(const cJSON* audio_params);
+    /// @brief Offer protocol version 4 batching in the client hello
+    void AddBatchFeature(cJSON* features);
+    /// @brief Switch to protocol version 4 if the server hello asks for it, after ParseAudioParams()
+    void ParseBatchParams(const cJSON* root);
+    /// @brief A packet for incoming audio, its payload keeps the capacity of earlier frames
+    std::unique_ptr<AudioStreamPacket> AcquirePacket();
 };
 
 #endif // PROTOCOL_H
@@ -0,0 +1,61 @@
+#include "sequence_window.h"
+
+void SequenceWindow::Reset() {
+    started_ = false;
+    first_ = 0;
+    newest_ = 0;
+    arrived_ = 0;
+    expected_ = 0;
+    received_ = 0;
+    reordered_ = 0;
+    duplicates_ = 0;
+    too_old_ = 0;
+}
+
+SequenceWindow::Result SequenceWindow::Check(uint32_t sequence) {
+    if (!started_) {
+        started_ = true;
+        first_ = sequence;
+        newest_ = sequence;
+        arrived_ = 1;
+        expected_ = 1;
+        received_++;
+        return kSequenceNext;
+    }
+
+    /* Wrap-safe distance, positive when the packet is newer than the newest one */
+    int32_t ahead = (int32_t)(sequence - newest_);
+    if (ahead > 0) {
+        arrived_ = ahead < SEQUENCE_WINDOW_SIZE ? (arrived_ << ahead) | 1 : 1;
+        newest_ = sequence;
+        expected_ = newest_ - first_ + 1;
+        received_++;
+        return ahead == 1 ? kSequenceNext : kSequenceGap;
+    }
+
+    uint32_t behind = -ahead;
+    if (behind >= SEQUENCE_WINDOW_SIZE) {
+        too_old_++;
+        return kSequenceTooOld;
+    }
+    uint64_t bit = 1ULL << behind;
+    if (arrived_ & bit) {
+        duplicates_++;
+        return kSequenceDuplicate;
+    }
+    arrived_ |= bit;
+    received_++;
+    reordered_++;
+    return kSequenceReordered;
+}
+
+SequenceWindow::Statistics SequenceWindow::statistics() const {
+    Statistics statistics;
+    statistics.received = received_;
+    uint32_t expected = expected_;
+    statistics.lost = expected > statistics.received ? expected - statistics.received : 0;
+    statistics.reordered = reordered_;
+    statistics.duplicates = duplicates_;
+    statistics.too_old = too_old_;
+    return statistics;
+}
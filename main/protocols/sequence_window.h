@@ -0,0 +1,58 @@
+#ifndef SEQUENCE_WINDOW_H
+#define SEQUENCE_WINDOW_H
+
+#include <atomic>
+#include <cstdint>
+
+/* How far behind the newest packet a reordered one is still accepted */
+#define SEQUENCE_WINDOW_SIZE 64
+
+/*
+ * Checks the sequence numbers of a datagram stream, one session at a time.
+ *
+ * Remembers which of the last SEQUENCE_WINDOW_SIZE sequence numbers have arrived. A packet behind
+ * the newest one is accepted if it has not been seen yet, the jitter buffer puts it back in order
+ * and conceals what is still missing once it can not wait any longer. A packet seen before is a
+ * duplicate, and one older than the window is dropped.
+ *
+ * Check() and Reset() are called by the receiving task. statistics() may be read from any task.
+ */
+class SequenceWindow {
+public:
+    enum Result {
+        kSequenceNext,          // The packet after the newest one
+        kSequenceGap,           // Newer, with packets missing in between
+        kSequenceReordered,     // Behind the newest one, fills a gap
+        kSequenceDuplicate,     // Arrived before, drop it
+        kSequenceTooOld,        // Behind the window, drop it
+    };
+
+    struct Statistics {
+        uint32_t received = 0;      // Distinct packets accepted
+        uint32_t lost = 0;          // Never arrived, or arrived behind the window
+        uint32_t reordered = 0;
+        uint32_t duplicates = 0;
+        uint32_t too_old = 0;
+    };
+
+    /// @brief Start a new session
+    void Reset();
+    /// @brief Classify an arrived packet and remember it unless it is dropped
+    Result Check(uint32_t sequence);
+    Statistics statistics() const;
+    uint32_t newest() const { return newest_; }
+
+private:
+    bool started_ = false;
+    uint32_t first_ = 0;
+    uint32_t newest_ = 0;
+    uint64_t arrived_ = 0;  // Bit n is set if newest_ - n arrived
+
+    std::atomic<uint32_t> expected_{0};
+    std::atomic<uint32_t> received_{0};
+    std::atomic<uint32_t> reordered_{0};
+    std::atomic<uint32_t> duplicates_{0};
+    std::atomic<uint32_t> too_old_{0};
+};
+
+#endif // SEQUENCE_WINDOW_H
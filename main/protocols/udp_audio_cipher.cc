@@ -0,0 +1,49 @@
+#include "udp_audio_cipher.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+
+UdpAudioCipher::UdpAudioCipher() {
+    mbedtls_aes_init(&aes_ctx_);
+}
+
+UdpAudioCipher::~UdpAudioCipher() {
+    mbedtls_aes_free(&aes_ctx_);
+}
+
+void UdpAudioCipher::SetKey(const std::string& key, const std::string& nonce) {
+    nonce_ = nonce;
+    nonce_.resize(kNonceSize);
+    mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)key.c_str(), 128);
+}
+
+bool UdpAudioCipher::Encrypt(const uint8_t* payload, size_t size, uint32_t timestamp, uint32_t sequence,
+    std::string& datagram) {
+    /* The nonce goes out as the header, the cipher counts up a copy of it */
+    datagram.resize(kNonceSize + size);
+    auto header = (uint8_t*)datagram.data();
+    memcpy(header, nonce_.data(), kNonceSize);
+    *(uint16_t*)&header[2] = htons(size);
+    *(uint32_t*)&header[8] = htonl(timestamp);
+    *(uint32_t*)&header[12] = htonl(sequence);
+    uint8_t nonce_counter[kNonceSize];
+    memcpy(nonce_counter, header, kNonceSize);
+
+    size_t nc_off = 0;
+    uint8_t stream_block[16] = {0};
+    return mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, nonce_counter, stream_block,
+        payload, header + kNonceSize) == 0;
+}
+
+bool UdpAudioCipher::Decrypt(const uint8_t* datagram, size_t size, uint8_t* dest) {
+    if (size < kNonceSize) {
+        return false;
+    }
+    /* The received nonce stays as it is, the cipher counts up a copy of it */
+    uint8_t nonce_counter[kNonceSize];
+    memcpy(nonce_counter, datagram, kNonceSize);
+    size_t nc_off = 0;
+    uint8_t stream_block[16] = {0};
+    return mbedtls_aes_crypt_ctr(&aes_ctx_, size - kNonceSize, &nc_off, nonce_counter, stream_block,
+        datagram + kNonceSize, dest) == 0;
+}
@@ -0,0 +1,40 @@
+#ifndef UDP_AUDIO_CIPHER_H
+#define UDP_AUDIO_CIPHER_H
+
+#include <mbedtls/aes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * The AES-128-CTR framing of the MQTT+UDP audio channel.
+ *
+ * A datagram is the 16-byte nonce from the server hello with the payload size, timestamp and
+ * sequence number written into it, followed by the payload encrypted with that nonce as the
+ * initial counter. The nonce header is written in place in front of the ciphertext, and the
+ * cipher counts up a copy of it on the stack, so neither direction allocates per datagram.
+ *
+ * SetKey() is called before the channel opens. Encrypt() and Decrypt() only read the key, so the
+ * sending and the receiving task may use them at the same time.
+ */
+class UdpAudioCipher {
+public:
+    static constexpr size_t kNonceSize = 16;
+
+    UdpAudioCipher();
+    ~UdpAudioCipher();
+
+    /// @brief The key and nonce of the server hello, 16 bytes each
+    void SetKey(const std::string& key, const std::string& nonce);
+    /// @brief Build the datagram for the payload in `datagram`, which keeps its capacity between calls
+    bool Encrypt(const uint8_t* payload, size_t size, uint32_t timestamp, uint32_t sequence, std::string& datagram);
+    /// @brief Decrypt the payload of a received datagram into `dest`, which holds size - kNonceSize bytes
+    bool Decrypt(const uint8_t* datagram, size_t size, uint8_t* dest);
+
+private:
+    mbedtls_aes_context aes_ctx_;
+    std::string nonce_;
+};
+
+#endif // UDP_AUDIO_CIPHER_H
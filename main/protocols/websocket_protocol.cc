@@ -25,38 +25,60 @@ bool WebsocketProtocol::Start() {
     return true;
 }
 
-bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
+bool WebsocketProtocol::SendAudio(AudioStreamPacket& packet) {
     if (websocket_ == nullptr || !websocket_->IsConnected()) {
         return false;
     }
 
+    if (batch_max_frames_ > 0) {
+        if (!audio_batch_.Add(packet, batch_frames_)) {
+            if (!FlushAudio() || !audio_batch_.Add(packet, batch_frames_)) {
+                return false;
+            }
+        }
+        if (audio_batch_.frame_count() >= (size_t)batch_frames_) {
+            return FlushAudio();
+        }
+        return true;
+    }
+
+    /* The header goes into the headroom right before the payload, both are sent as one block */
     if (version_ == 2) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol2) + packet->payload.size());
-        auto bp2 = (BinaryProtocol2*)serialized.data();
+        auto bp2 = (BinaryProtocol2*)packet.payload.Header(sizeof(BinaryProtocol2));
         bp2->version = htons(version_);
         bp2->type = 0;
         bp2->reserved = 0;
-        bp2->timestamp = htonl(packet->timestamp);
-        bp2->payload_size = htonl(packet->payload.size());
-        memcpy(bp2->payload, packet->payload.data(), packet->payload.size());
+        bp2->timestamp = htonl(packet.timestamp);
+        bp2->payload_size = htonl(packet.payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        return websocket_->Send(bp2, sizeof(BinaryProtocol2) + packet.payload.size(), true);
     } else if (version_ == 3) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol3) + packet->payload.size());
-        auto bp3 = (BinaryProtocol3*)serialized.data();
+        auto bp3 = (BinaryProtocol3*)packet.payload.Header(sizeof(BinaryProtocol3));
         bp3->type = 0;
         bp3->reserved = 0;
-        bp3->payload_size = htons(packet->payload.size());
-        memcpy(bp3->payload, packet->payload.data(), packet->payload.size());
+        bp3->payload_size = htons(packet.payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        return websocket_->Send(bp3, sizeof(BinaryProtocol3) + packet.payload.size(), true);
     } else {
-        return websocket_->Send(packet->payload.data(), packet->payload.size(), true);
+        return websocket_->Send(packet.payload.data(), packet.payload.size(), true);
     }
 }
 
+bool WebsocketProtocol::FlushAudio() {
+    if (audio_batch_.empty()) {
+        return true;
+    }
+    size_t size = 0;
+    auto message = audio_batch_.Finish(size);
+    bool sent = websocket_ != nullptr && websocket_->IsConnected() && websocket_->Send(message, size, true);
+    audio_batch_.Reset();
+    return sent;
+}
+
+void WebsocketProtocol::DiscardAudio() {
+    audio_batch_.Reset();
+}
+
 bool WebsocketProtocol::SendText(const std::string& text) {
     if (websocket_ == nullptr || !websocket_->IsConnected()) {
         return false;
@@ -90,6 +112,9 @@ bool WebsocketProtocol::OpenAudioChannel() {
     }
 
     error_occurred_ = false;
+    batch_max_frames_ = 0;
+    batch_frames_ = 1;
+    audio_batch_.Reset();
 
     auto network = Board::GetInstance().GetNetwork();
     websocket_ = network->CreateWebSocket(1);
@@ -110,40 +135,54 @@ bool WebsocketProtocol::OpenAudioChannel() {
     websocket_->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
 
     websocket_->OnData([this](const char* data, size_t len, bool binary) {
+        last_incoming_time_ = std::chrono::steady_clock::now();
         if (binary) {
             if (on_incoming_audio_ != nullptr) {
+                /* The header is read where it is, the payload is copied once into a pooled packet */
+                auto frame = (const uint8_t*)data;
+                if (batch_max_frames_ > 0) {
+                    auto on_frame = [this](size_t index, uint32_t timestamp, const uint8_t* payload, size_t payload_size) {
+                        auto packet = AcquirePacket();
+                        packet->sample_rate = server_sample_rate_;
+                        packet->frame_duration = server_frame_duration_;
+                        packet->timestamp = timestamp;
+                        packet->sequence = 0;
+                        packet->payload.assign(payload, payload + payload_size);
+                        on_incoming_audio_(std::move(packet));
+                    };
+                    if (!AudioBatch::Parse(frame, len, server_frame_duration_, on_frame)) {
+                        ESP_LOGE(TAG, "Invalid audio batch, size: %u", len);
+                    }
+                    return;
+                }
+                uint32_t timestamp = 0;
+                const uint8_t* payload = frame;
+                size_t payload_size = len;
                 if (version_ == 2) {
-                    BinaryProtocol2* bp2 = (BinaryProtocol2*)data;
-                    bp2->version = ntohs(bp2->version);
-                    bp2->type = ntohs(bp2->type);
-                    bp2->timestamp = ntohl(bp2->timestamp);
-                    bp2->payload_size = ntohl(bp2->payload_size);
-                    auto payload = (uint8_t*)bp2->payload;
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = bp2->timestamp,
-                        .payload = std::vector<uint8_t>(payload, payload + bp2->payload_size)
-                    }));
+                    auto bp2 = (const BinaryProtocol2*)frame;
+                    if (len < sizeof(BinaryProtocol2) || ntohl(bp2->payload_size) > len - sizeof(BinaryProtocol2)) {
+                        ESP_LOGE(TAG, "Invalid audio frame size: %u", len);
+                        return;
+                    }
+                    timestamp = ntohl(bp2->timestamp);
+                    payload = bp2->payload;
+                    payload_size = ntohl(bp2->payload_size);
                 } else if (version_ == 3) {
-                    BinaryProtocol3* bp3 = (BinaryProtocol3*)data;
-                    bp3->type = bp3->type;
-                    bp3->payload_size = ntohs(bp3->payload_size);
-                    auto payload = (uint8_t*)bp3->payload;
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>(payload, payload + bp3->payload_size)
-                    }));
-                } else {
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>((uint8_t*)data, (uint8_t*)data + len)
-                    }));
+                    auto bp3 = (const BinaryProtocol3*)frame;
+                    if (len < sizeof(BinaryProtocol3) || ntohs(bp3->payload_size) > len - sizeof(BinaryProtocol3)) {
+                        ESP_LOGE(TAG, "Invalid audio frame size: %u", len);
+                        return;
+                    }
+                    payload = bp3->payload;
+                    payload_size = ntohs(bp3->payload_size);
                 }
+                auto packet = AcquirePacket();
+                packet->sample_rate = server_sample_rate_;
+                packet->frame_duration = server_frame_duration_;
+                packet->timestamp = timestamp;
+                packet->sequence = 0;
+                packet->payload.assign(payload, payload + payload_size);
+                on_incoming_audio_(std::move(packet));
             }
         } else {
             // Parse JSON data
@@ -162,7 +201,6 @@ bool WebsocketProtocol::OpenAudioChannel() {
             }
             cJSON_Delete(root);
         }
-        last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
     websocket_->OnDisconnected([this]() {
@@ -181,6 +219,7 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
     // Send hello message to describe the client
     auto message = GetHelloMessage();
+    hello_time_ = std::chrono::steady_clock::now();
     if (!SendText(message)) {
         return false;
     }
@@ -210,13 +249,14 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+    AddBatchFeature(features);
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", preferred_frame_duration_);
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -238,17 +278,8 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
-    }
+    ParseAudioParams(cJSON_GetObjectItem(root, "audio_params"));
+    ParseBatchParams(root);
 
     xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT);
 }
@@ -3,6 +3,7 @@
 
 
 #include "protocol.h"
+#include "audio_batch.h"
 
 #include <web_socket.h>
 #include <freertos/FreeRTOS.h>
@@ -16,7 +17,9 @@ public:
     ~WebsocketProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    bool FlushAudio() override;
+    void DiscardAudio() override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel(bool send_goodbye = true) override;
     bool IsAudioChannelOpened() const override;
@@ -25,6 +28,8 @@ private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
+    // Uplink frames waiting for a protocol version 4 message, used by the sending task
+    AudioBatch audio_batch_;
 
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;